@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Time stamp counter on x86, nanoseconds elsewhere, as a stand-in for the CPU cycle counter.
+uint32_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Bytes of heap not in use, as reported by the C library.
+int esp_get_free_internal_heap_size(void);
+int esp_get_free_heap_size(void);
@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * The subset of the FreeRTOS API used by epdiy, implemented with POSIX threads.
+ * Ticks are milliseconds.
+ */
+
+#include <stdint.h>
+
+// included indirectly by FreeRTOS.h in ESP-IDF
+#include <assert.h>
+#include "esp_system.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+/// The "core" passed when creating the calling task, 0 for other threads.
+BaseType_t xPortGetCoreID(void);
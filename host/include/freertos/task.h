@@ -0,0 +1,34 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t func,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* handle,
+    BaseType_t core_id
+);
+BaseType_t xTaskCreate(
+    TaskFunction_t func,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* handle
+);
+
+/// Delete a task. Other tasks are stopped at their next `ulTaskNotifyTake()`,
+/// this waits until they are.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken);
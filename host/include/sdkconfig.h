@@ -0,0 +1,4 @@
+#pragma once
+
+/// Configuration of host builds, see `host/CMakeLists.txt`.
+#define CONFIG_IDF_TARGET_LINUX 1
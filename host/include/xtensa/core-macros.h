@@ -0,0 +1,5 @@
+#pragma once
+
+#include "esp_cpu.h"
+
+#define XTHAL_GET_CCOUNT() esp_cpu_get_cycle_count()
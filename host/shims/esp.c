@@ -0,0 +1,87 @@
+/**
+ * Heap, timer and system functions of ESP-IDF used by epdiy, on the host.
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    return realloc(ptr, size);
+}
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    void* ptr = NULL;
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void* heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size, uint32_t caps) {
+    void* ptr = heap_caps_aligned_alloc(alignment, n * size, caps);
+    if (ptr != NULL) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return (size_t)esp_get_free_heap_size();
+}
+
+bool heap_caps_check_integrity_all(bool print_errors) {
+    return true;
+}
+
+int esp_get_free_heap_size(void) {
+    // The heap is not bounded on the host, report the bytes in use below a nominal
+    // 1 GiB so that differences between calls reflect leaks.
+    struct mallinfo2 info = mallinfo2();
+    return (1 << 30) - (int)info.uordblks;
+}
+
+int esp_get_free_internal_heap_size(void) {
+    return esp_get_free_heap_size();
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t esp_cpu_get_cycle_count(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#endif
+}
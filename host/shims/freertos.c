@@ -0,0 +1,288 @@
+/**
+ * FreeRTOS tasks, notifications and semaphores on top of POSIX threads.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/**
+ * Tasks run on pooled threads, which are reused after a task is deleted.
+ * This keeps the heap usage of repeated initialization stable,
+ * as the C library allocates memory for each new thread.
+ */
+struct HostTask {
+    pthread_t thread;
+    struct HostTask* next;
+    /// Where the thread returns to when the task is deleted.
+    jmp_buf exit;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    TaskFunction_t func;
+    void* arg;
+    BaseType_t core_id;
+    uint32_t notifications;
+    bool deleted;
+};
+
+struct HostSemaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+static _Thread_local struct HostTask* current_task = NULL;
+
+/// Absolute deadline `ticks` milliseconds from now.
+static struct timespec deadline_after(TickType_t ticks) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec += 1;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+/// Wait on `cond` for at most `ticks`, returns false on timeout.
+static bool cond_wait_ticks(pthread_cond_t* cond, pthread_mutex_t* lock, TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    struct timespec deadline = deadline_after(ticks);
+    return pthread_cond_timedwait(cond, lock, &deadline) != ETIMEDOUT;
+}
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct HostTask* pool = NULL;
+
+static void* task_entry(void* arg) {
+    struct HostTask* task = (struct HostTask*)arg;
+    current_task = task;
+
+    pthread_mutex_lock(&task->lock);
+    while (true) {
+        while (task->func == NULL) {
+            pthread_cond_wait(&task->cond, &task->lock);
+        }
+        pthread_mutex_unlock(&task->lock);
+
+        if (setjmp(task->exit) == 0) {
+            task->func(task->arg);
+        }
+
+        pthread_mutex_lock(&task->lock);
+        task->func = NULL;
+        task->deleted = false;
+        task->notifications = 0;
+        pthread_cond_broadcast(&task->cond);
+
+        pthread_mutex_lock(&pool_lock);
+        task->next = pool;
+        pool = task;
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return NULL;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    if (current_task == NULL || current_task->core_id == tskNO_AFFINITY) {
+        return 0;
+    }
+    return current_task->core_id % portNUM_PROCESSORS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t func,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* handle,
+    BaseType_t core_id
+) {
+    pthread_mutex_lock(&pool_lock);
+    struct HostTask* task = pool;
+    if (task != NULL) {
+        pool = task->next;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (task == NULL) {
+        task = calloc(1, sizeof(struct HostTask));
+        if (task == NULL) {
+            return pdFAIL;
+        }
+        pthread_mutex_init(&task->lock, NULL);
+        pthread_cond_init(&task->cond, NULL);
+        if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+            free(task);
+            return pdFAIL;
+        }
+    }
+
+    pthread_mutex_lock(&task->lock);
+    task->arg = arg;
+    task->core_id = core_id;
+    task->func = func;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+
+    if (handle != NULL) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(
+    TaskFunction_t func,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* handle
+) {
+    return xTaskCreatePinnedToCore(func, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == current_task) {
+        longjmp(current_task->exit, 1);
+    }
+
+    pthread_mutex_lock(&task->lock);
+    task->deleted = true;
+    pthread_cond_broadcast(&task->cond);
+    while (task->func != NULL) {
+        pthread_cond_wait(&task->cond, &task->lock);
+    }
+    pthread_mutex_unlock(&task->lock);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = {
+        .tv_sec = ticks / 1000,
+        .tv_nsec = (long)(ticks % 1000) * 1000000,
+    };
+    if (ticks == 0) {
+        sched_yield();
+    } else {
+        nanosleep(&ts, NULL);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    struct HostTask* task = current_task;
+    if (task == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notifications == 0 && !task->deleted) {
+        if (!cond_wait_ticks(&task->cond, &task->lock, ticks_to_wait)) {
+            break;
+        }
+    }
+    if (task->deleted) {
+        pthread_mutex_unlock(&task->lock);
+        longjmp(task->exit, 1);
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notifications++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    struct HostSemaphore* semaphore = calloc(1, sizeof(struct HostSemaphore));
+    if (semaphore == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&semaphore->lock, NULL);
+    pthread_cond_init(&semaphore->cond, NULL);
+    semaphore->count = initial_count;
+    semaphore->max_count = max_count;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    if (semaphore == NULL) {
+        return;
+    }
+    pthread_cond_destroy(&semaphore->cond);
+    pthread_mutex_destroy(&semaphore->lock);
+    free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    pthread_mutex_lock(&semaphore->lock);
+    while (semaphore->count == 0) {
+        if (ticks_to_wait == 0
+            || !cond_wait_ticks(&semaphore->cond, &semaphore->lock, ticks_to_wait)) {
+            break;
+        }
+    }
+    BaseType_t taken = semaphore->count > 0;
+    if (taken) {
+        semaphore->count--;
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    pthread_mutex_lock(&semaphore->lock);
+    BaseType_t given = semaphore->count < semaphore->max_count;
+    if (given) {
+        semaphore->count++;
+        pthread_cond_signal(&semaphore->cond);
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+    return given ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(
+    SemaphoreHandle_t semaphore, BaseType_t* higher_priority_task_woken
+) {
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
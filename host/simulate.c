@@ -0,0 +1,113 @@
+/**
+ * Draw a 16 level grayscale gradient on a white ED097TC2 with the builtin GC16 waveform
+ * and predict the result with the panel model.
+ *
+ *   epdiy_simulate [--trace trace.json] [pgm_prefix]
+ *
+ * Prints the update time and the predicted gray value of each level.
+ * With `pgm_prefix`, the predicted image after each frame is written as PGM.
+ * With `--trace`, the update pipeline is recorded as Chrome trace JSON.
+ */
+
+#include <esp_heap_caps.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epdiy.h"
+#include "output_host/panel_model.h"
+#include "output_host/render_host.h"
+
+int main(int argc, char** argv) {
+    const char* pgm_prefix = NULL;
+    const char* trace_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else {
+            pgm_prefix = argv[i];
+        }
+    }
+
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    if (trace_file != NULL && !epd_trace_start(1 << 17)) {
+        fprintf(stderr, "could not allocate the trace buffer\n");
+        return 1;
+    }
+    epd_host_set_capture(true);
+    int width = epd_width();
+    int height = epd_height();
+
+    // 16 columns of increasing gray levels
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, width / 2 * height, MALLOC_CAP_DEFAULT);
+    for (int x = 0; x < width; x += 2) {
+        uint8_t level = x * 16 / width;
+        memset(framebuffer + x / 2, level | (level << 4), 1);
+    }
+    for (int y = 1; y < height; y++) {
+        memcpy(framebuffer + y * width / 2, framebuffer, width / 2);
+    }
+
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        NULL,
+        epd_get_display()->default_waveform
+    );
+    if (err != EPD_DRAW_SUCCESS) {
+        fprintf(stderr, "draw error: %X\n", err);
+        return 1;
+    }
+
+    if (trace_file != NULL) {
+        epd_trace_stop();
+        FILE* out = fopen(trace_file, "w");
+        if (out == NULL) {
+            fprintf(stderr, "could not open %s\n", trace_file);
+            return 1;
+        }
+        epd_trace_write_json(out);
+        fclose(out);
+        epd_trace_free();
+    }
+
+    EpdPanelModel model;
+    if (!epd_panel_model_init(&model, width, height)) {
+        return 1;
+    }
+    const EpdHostCapture* capture = epd_host_capture();
+    double time_us = epd_panel_model_apply_capture(&model, capture, pgm_prefix);
+    printf("frames: %d, update time: %.1f ms\n", capture->frames, time_us / 1000.0);
+
+    const EpdRenderStats* stats = epd_get_render_stats();
+    printf(
+        "workers: %d, queue: min %d avg %.1f of %d, lines driven: %d, skipped: %d, "
+        "underruns: %d\n",
+        stats->workers,
+        stats->queue_min,
+        stats->queue_avg,
+        stats->queue_capacity,
+        stats->lines_driven,
+        stats->lines_skipped,
+        stats->underruns
+    );
+
+    uint8_t* image = malloc(width * height);
+    epd_panel_model_image(&model, image);
+    printf("level  target  predicted\n");
+    for (int level = 0; level < 16; level++) {
+        int x = (2 * level + 1) * width / 32;
+        printf("%5d  %6d  %9d\n", level, level * 17, image[height / 2 * width + x]);
+    }
+
+    free(image);
+    epd_panel_model_free(&model);
+    heap_caps_free(framebuffer);
+    epd_deinit();
+    return 0;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+/**
+ * Minimal stand-in for the ESP-IDF unity component, so that the test cases
+ * in `test/` can be run on the host. See `unity_runner.c`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+typedef void (*unity_test_func_t)(void);
+
+void unity_register_test(const char* name, const char* tags, unity_test_func_t func);
+void unity_fail(const char* file, int line, const char* message);
+
+#define UNITY_CONCAT_(a, b) a##b
+#define UNITY_CONCAT(a, b) UNITY_CONCAT_(a, b)
+
+#define TEST_CASE(name_, tags_)                                                      \
+    static void UNITY_CONCAT(unity_test_, __LINE__)(void);                           \
+    static void __attribute__((constructor)) UNITY_CONCAT(unity_register_, __LINE__)( \
+        void                                                                         \
+    ) {                                                                              \
+        unity_register_test(name_, tags_, &UNITY_CONCAT(unity_test_, __LINE__));     \
+    }                                                                                \
+    static void UNITY_CONCAT(unity_test_, __LINE__)(void)
+
+/// Tests which are disabled for some targets depend on target features,
+/// which the host does not have.
+#define DISABLED_FOR_TARGETS(...) 1
+
+#define TEST_FAIL_MESSAGE(message) unity_fail(__FILE__, __LINE__, message)
+
+#define TEST_ASSERT(condition)                          \
+    do {                                                \
+        if (!(condition)) {                             \
+            TEST_FAIL_MESSAGE("expected " #condition); \
+        }                                               \
+    } while (0)
+
+#define TEST_ASSERT_TRUE(condition) TEST_ASSERT(condition)
+#define TEST_ASSERT_FALSE(condition) TEST_ASSERT(!(condition))
+#define TEST_ASSERT_NULL(pointer) TEST_ASSERT((pointer) == NULL)
+#define TEST_ASSERT_NOT_NULL(pointer) TEST_ASSERT((pointer) != NULL)
+#define TEST_ASSERT_EQUAL_PTR(expected, actual) TEST_ASSERT((expected) == (actual))
+
+#define TEST_ASSERT_EQUAL(expected, actual)                                        \
+    do {                                                                           \
+        long long expected_ = (long long)(expected);                               \
+        long long actual_ = (long long)(actual);                                   \
+        if (expected_ != actual_) {                                                \
+            char message_[96];                                                     \
+            snprintf(                                                              \
+                message_, sizeof(message_), "expected %lld, was %lld", expected_, actual_ \
+            );                                                                     \
+            TEST_FAIL_MESSAGE(message_);                                           \
+        }                                                                          \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_INT(expected, actual) TEST_ASSERT_EQUAL(expected, actual)
+#define TEST_ASSERT_EQUAL_UINT8(expected, actual) TEST_ASSERT_EQUAL(expected, actual)
+#define TEST_ASSERT_EQUAL_UINT16(expected, actual) TEST_ASSERT_EQUAL(expected, actual)
+#define TEST_ASSERT_EQUAL_UINT32(expected, actual) TEST_ASSERT_EQUAL(expected, actual)
+
+#define TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, len)                                 \
+    do {                                                                                     \
+        const uint8_t* expected_ = (const uint8_t*)(expected);                               \
+        const uint8_t* actual_ = (const uint8_t*)(actual);                                   \
+        for (size_t i_ = 0; i_ < (size_t)(len); i_++) {                                      \
+            if (expected_[i_] != actual_[i_]) {                                              \
+                char message_[96];                                                           \
+                snprintf(                                                                    \
+                    message_, sizeof(message_), "element %zu: expected 0x%02X, was 0x%02X", i_, \
+                    expected_[i_], actual_[i_]                                               \
+                );                                                                           \
+                TEST_FAIL_MESSAGE(message_);                                                 \
+            }                                                                                \
+        }                                                                                    \
+    } while (0)
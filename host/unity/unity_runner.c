@@ -0,0 +1,81 @@
+/**
+ * Runs the registered test cases whose tags contain all tags given as arguments,
+ * e.g. `epdiy_tests unit`. Returns non-zero if any test fails.
+ */
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unity.h"
+
+#define MAX_TESTS 256
+
+typedef struct {
+    const char* name;
+    const char* tags;
+    unity_test_func_t func;
+} UnityTest;
+
+static UnityTest tests[MAX_TESTS];
+static int num_tests = 0;
+static jmp_buf test_abort;
+
+void unity_register_test(const char* name, const char* tags, unity_test_func_t func) {
+    if (num_tests >= MAX_TESTS) {
+        fprintf(stderr, "too many test cases, increase MAX_TESTS\n");
+        abort();
+    }
+    tests[num_tests++] = (UnityTest){ .name = name, .tags = tags, .func = func };
+}
+
+void unity_fail(const char* file, int line, const char* message) {
+    fprintf(stderr, "%s:%d: FAIL: %s\n", file, line, message);
+    longjmp(test_abort, 1);
+}
+
+/// Whether `tags`, formatted as "[a,b,c]", contains `tag`.
+static bool has_tag(const char* tags, const char* tag) {
+    size_t len = strlen(tag);
+    const char* p = tags;
+    while ((p = strstr(p, tag)) != NULL) {
+        bool start = p == tags || p[-1] == '[' || p[-1] == ',';
+        bool end = p[len] == ']' || p[len] == ',' || p[len] == '\0';
+        if (start && end) {
+            return true;
+        }
+        p += len;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    int run = 0;
+    int failed = 0;
+
+    for (int t = 0; t < num_tests; t++) {
+        bool selected = true;
+        for (int a = 1; a < argc; a++) {
+            selected &= has_tag(tests[t].tags, argv[a]);
+        }
+        if (!selected) {
+            continue;
+        }
+
+        run++;
+        printf("Running %s %s...\n", tests[t].name, tests[t].tags);
+        fflush(stdout);
+        if (setjmp(test_abort) == 0) {
+            tests[t].func();
+            printf("%s: PASS\n", tests[t].name);
+        } else {
+            printf("%s: FAIL\n", tests[t].name);
+            failed++;
+        }
+    }
+
+    printf("\n%d Tests %d Failures\n", run, failed);
+    return failed > 0 || run == 0;
+}
@@ -126,6 +126,8 @@ extern const EpdBoardDefinition epd_board_v5;
 extern const EpdBoardDefinition epd_board_v6;
 extern const EpdBoardDefinition epd_board_v7;
 extern const EpdBoardDefinition epd_board_v7_raw;
+/// Simulated board for host builds, see `output_host/render_host.h`.
+extern const EpdBoardDefinition epd_board_host;
 
 /**
  * Helper for short, precise delays.
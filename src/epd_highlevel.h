@@ -69,6 +69,20 @@ extern "C" {
 
 #define EPD_BUILTIN_WAVEFORM NULL
 
+/// Options for the high-level state, see `epd_hl_init_with_options()`.
+enum EpdHlOptions {
+    /// Use the default options.
+    EPD_HL_DEFAULT = 0,
+    /// Track which tiles of the front framebuffer are drawn to,
+    /// and only calculate differences and update buffers for those.
+    /// Direct writes to the framebuffer memory must be reported with `epd_hl_mark_dirty()`.
+    EPD_HL_TRACK_DAMAGE = 1,
+    /// Do not allocate a difference image, but let the render threads
+    /// interlace the front and back framebuffers while drawing.
+    /// Saves `epd_width() * epd_height()` bytes of PSRAM and the bandwidth to write and read them.
+    EPD_HL_ON_THE_FLY_DIFFERENCE = 2,
+};
+
 /// Holds the internal state of the high-level API.
 typedef struct {
     /// The "front" framebuffer object.
@@ -76,11 +90,19 @@ typedef struct {
     /// The "back" framebuffer object.
     uint8_t* back_fb;
     /// Buffer for holding the interlaced difference image.
+    /// `NULL` with `EPD_HL_ON_THE_FLY_DIFFERENCE`.
     uint8_t* difference_fb;
     /// Tainted lines based on the last difference calculation.
     bool* dirty_lines;
     /// Tainted column nibbles based on the last difference calculation.
     uint8_t* dirty_columns;
+    /// Tiles of the front framebuffer that may differ from the back framebuffer,
+    /// see `epd_track_damage()`. `NULL` if damage tracking is disabled.
+    uint8_t* dirty_tiles;
+    /// Gray level transitions present in the last difference calculation.
+    EpdTransitions transitions;
+    /// Gray level transitions of each line in the last difference calculation.
+    EpdTransitions* line_transitions;
     /// The waveform information to use.
     const EpdWaveform* waveform;
 } EpdiyHighlevelState;
@@ -97,6 +119,22 @@ typedef struct {
  */
 EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform);
 
+/**
+ * Initialize a state object with additional options.
+ *
+ * @param waveform: See `epd_hl_init()`.
+ * @param options: A combination of `EpdHlOptions` flags.
+ * @returns An initialized state object.
+ */
+EpdiyHighlevelState epd_hl_init_with_options(const EpdWaveform* waveform, int options);
+
+/**
+ * Free the buffers of a state object, so a new one can be initialized.
+ *
+ * @param state: A reference to the `EpdiyHighlevelState` object to free.
+ */
+void epd_hl_deinit(EpdiyHighlevelState* state);
+
 /// Get a reference to the front framebuffer.
 /// Use this to draw on the framebuffer before updating the screen with `epd_hl_update_screen()`.
 uint8_t* epd_hl_get_framebuffer(EpdiyHighlevelState* state);
@@ -134,6 +172,16 @@ enum EpdDrawError epd_hl_update_area(
     EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area
 );
 
+/**
+ * Mark an area of the front framebuffer as modified.
+ * This is only required with `EPD_HL_TRACK_DAMAGE` and if the framebuffer memory
+ * was written without using the drawing functions of `epdiy.h`.
+ *
+ * @param state: A reference to the `EpdiyHighlevelState` object used.
+ * @param area: The modified area, in (rotated) drawing coordinates.
+ */
+void epd_hl_mark_dirty(EpdiyHighlevelState* state, EpdRect area);
+
 /**
  * Reset the front framebuffer to a white state.
  *
@@ -8,18 +8,31 @@
 #include <esp_heap_caps.h>
 #include <esp_log.h>
 #include <esp_types.h>
-
-// Simple x and y coordinate
-typedef struct {
-    uint16_t x;
-    uint16_t y;
-} Coord_xy;
+#include <string.h>
 
 static const EpdDisplay_t* display = NULL;
 
 // Display rotation. Can be updated using epd_set_rotation(enum EpdRotation)
 static enum EpdRotation display_rotation = EPD_ROT_LANDSCAPE;
 
+// Framebuffer whose modified tiles are recorded in `damage_tiles`, see epd_track_damage()
+static const uint8_t* damage_framebuffer = NULL;
+static uint8_t* damage_tiles = NULL;
+static int damage_tiles_x = 0;
+
+// Stack of clip rectangles in framebuffer coordinates, see epd_push_clip()
+static EpdRect clip_stack[EPD_MAX_CLIP_DEPTH];
+static int clip_depth = 0;
+// The current clip rectangle, the display area if the stack is empty
+static EpdRect clip_rect = { 0 };
+
+static inline int min(int x, int y) {
+    return x < y ? x : y;
+}
+static inline int max(int x, int y) {
+    return x > y ? x : y;
+}
+
 #ifndef _swap_int
 #define _swap_int(a, b) \
     {                   \
@@ -38,73 +51,291 @@ void epd_clear() {
     epd_clear_area(epd_full_screen());
 }
 
-void epd_draw_hline(int x, int y, int length, uint8_t color, uint8_t* framebuffer) {
-    for (int i = 0; i < length; i++) {
-        int xx = x + i;
-        epd_draw_pixel(xx, y, color, framebuffer);
-    }
+/// Intersection of two rectangles, with zero width or height if they do not overlap.
+static EpdRect intersect_rect(EpdRect a, EpdRect b) {
+    int x_start = max(a.x, b.x);
+    int y_start = max(a.y, b.y);
+    int x_end = min(a.x + a.width, b.x + b.width);
+    int y_end = min(a.y + a.height, b.y + b.height);
+    EpdRect intersection = {
+        .x = x_start,
+        .y = y_start,
+        .width = max(x_end - x_start, 0),
+        .height = max(y_end - y_start, 0),
+    };
+    return intersection;
 }
 
-void epd_draw_vline(int x, int y, int length, uint8_t color, uint8_t* framebuffer) {
-    for (int i = 0; i < length; i++) {
-        int yy = y + i;
-        epd_draw_pixel(x, yy, color, framebuffer);
-    }
+/// The current clip rectangle in framebuffer coordinates.
+static inline EpdRect current_clip() {
+    return clip_rect;
 }
 
-Coord_xy _rotate(uint16_t x, uint16_t y) {
-    switch (display_rotation) {
-        case EPD_ROT_LANDSCAPE:
-            break;
-        case EPD_ROT_PORTRAIT:
-            _swap_int(x, y);
-            x = epd_width() - x - 1;
-            break;
-        case EPD_ROT_INVERTED_LANDSCAPE:
-            x = epd_width() - x - 1;
-            y = epd_height() - y - 1;
-            break;
-        case EPD_ROT_INVERTED_PORTRAIT:
-            _swap_int(x, y);
-            y = epd_height() - y - 1;
-            break;
+/**
+ * Draw pixel (`x`, `y`) in framebuffer coordinates with the upper nibble of `color`,
+ * if it is inside the clip rectangle.
+ */
+static inline void put_pixel(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    // negative offsets wrap around to large unsigned values
+    if ((unsigned)(x - clip_rect.x) >= (unsigned)clip_rect.width
+        || (unsigned)(y - clip_rect.y) >= (unsigned)clip_rect.height) {
+        return;
+    }
+
+    if (framebuffer == damage_framebuffer) {
+        int tile = (y / EPD_DAMAGE_TILE_SIZE) * damage_tiles_x + x / EPD_DAMAGE_TILE_SIZE;
+        damage_tiles[tile] = 1;
+    }
+
+    uint8_t* buf_ptr = &framebuffer[y * display->width / 2 + x / 2];
+    if (x % 2) {
+        *buf_ptr = (*buf_ptr & 0x0F) | (color & 0xF0);
+    } else {
+        *buf_ptr = (*buf_ptr & 0xF0) | (color >> 4);
     }
-    Coord_xy coord = { x, y };
-    return coord;
 }
 
-void epd_draw_pixel(int x, int y, uint8_t color, uint8_t* framebuffer) {
-    // Check rotation and move pixel around if necessary
-    Coord_xy coord = _rotate(x, y);
-    x = coord.x;
-    y = coord.y;
+static void draw_pixel_landscape(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    put_pixel(x, y, color, framebuffer);
+}
+
+static void draw_pixel_portrait(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    put_pixel(display->width - 1 - y, x, color, framebuffer);
+}
+
+static void draw_pixel_inverted_landscape(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    put_pixel(display->width - 1 - x, display->height - 1 - y, color, framebuffer);
+}
+
+static void draw_pixel_inverted_portrait(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    put_pixel(y, display->height - 1 - x, color, framebuffer);
+}
+
+static EpdRect rotate_rect_landscape(EpdRect rect) {
+    return rect;
+}
+
+static EpdRect rotate_rect_portrait(EpdRect rect) {
+    EpdRect rotated = {
+        .x = display->width - rect.y - rect.height,
+        .y = rect.x,
+        .width = rect.height,
+        .height = rect.width,
+    };
+    return rotated;
+}
+
+static EpdRect rotate_rect_inverted_landscape(EpdRect rect) {
+    EpdRect rotated = {
+        .x = display->width - rect.x - rect.width,
+        .y = display->height - rect.y - rect.height,
+        .width = rect.width,
+        .height = rect.height,
+    };
+    return rotated;
+}
 
-    if (x < 0 || x >= epd_width()) {
+static EpdRect rotate_rect_inverted_portrait(EpdRect rect) {
+    EpdRect rotated = {
+        .x = rect.y,
+        .y = display->height - rect.x - rect.width,
+        .width = rect.height,
+        .height = rect.width,
+    };
+    return rotated;
+}
+
+/// Change of the framebuffer coordinates per pixel along a rotated axis.
+typedef struct {
+    int8_t dx;
+    int8_t dy;
+} RotationStep;
+
+/**
+ * Drawing functions specialized for one display rotation.
+ * Selected by `epd_set_rotation()`, so drawing does not branch on the rotation per pixel.
+ */
+typedef struct {
+    /// Draw a pixel in rotated coordinates, see `epd_draw_pixel()`.
+    void (*draw_pixel)(int x, int y, uint8_t color, uint8_t* framebuffer);
+    /// Map a rectangle in rotated coordinates to framebuffer coordinates.
+    EpdRect (*rotate_rect)(EpdRect rect);
+    /// Framebuffer step of one pixel along the rotated x axis.
+    RotationStep step_x;
+    /// Framebuffer step of one pixel along the rotated y axis.
+    RotationStep step_y;
+} RotationBackend;
+
+static const RotationBackend rotation_backends[] = {
+    [EPD_ROT_LANDSCAPE] = { draw_pixel_landscape, rotate_rect_landscape, { 1, 0 }, { 0, 1 } },
+    [EPD_ROT_PORTRAIT] = { draw_pixel_portrait, rotate_rect_portrait, { 0, 1 }, { -1, 0 } },
+    [EPD_ROT_INVERTED_LANDSCAPE] = { draw_pixel_inverted_landscape,
+                                     rotate_rect_inverted_landscape,
+                                     { -1, 0 },
+                                     { 0, -1 } },
+    [EPD_ROT_INVERTED_PORTRAIT] = { draw_pixel_inverted_portrait,
+                                    rotate_rect_inverted_portrait,
+                                    { 0, -1 },
+                                    { 1, 0 } },
+};
+
+// Drawing functions for `display_rotation`
+static const RotationBackend* rotation_backend = &rotation_backends[EPD_ROT_LANDSCAPE];
+
+/// Map a rectangle in rotated display coordinates to framebuffer coordinates.
+static inline EpdRect _rotate_rect(EpdRect rect) {
+    return rotation_backend->rotate_rect(rect);
+}
+
+/// Map pixel (`x`, `y`) in rotated display coordinates to framebuffer coordinates.
+static inline void rotate_point(int x, int y, int* fx, int* fy) {
+    EpdRect pixel = { .x = x, .y = y, .width = 1, .height = 1 };
+    EpdRect rotated = _rotate_rect(pixel);
+    *fx = rotated.x;
+    *fy = rotated.y;
+}
+
+/**
+ * Fill a rectangle in framebuffer coordinates with the upper nibble of `color`.
+ * The rectangle is clipped once, then whole bytes are written per row,
+ * with nibble fix-ups at uneven edges.
+ */
+static void fill_framebuffer_rect(EpdRect rect, uint8_t color, uint8_t* framebuffer) {
+    EpdRect clipped = intersect_rect(rect, current_clip());
+    if (clipped.width == 0 || clipped.height == 0) {
         return;
     }
-    if (y < 0 || y >= epd_height()) {
+    epd_mark_damaged(framebuffer, clipped);
+
+    const int fb_width = epd_width();
+    int x_start = clipped.x;
+    int y_start = clipped.y;
+    int x_end = clipped.x + clipped.width;
+    int y_end = clipped.y + clipped.height;
+
+    const int line_bytes = fb_width / 2;
+    const uint8_t high = color & 0xF0;
+    const uint8_t low = color >> 4;
+    uint8_t* line = framebuffer + y_start * line_bytes;
+
+    // vertical lines only touch one nibble per row
+    if (clipped.width == 1) {
+        uint8_t* ptr = line + x_start / 2;
+        uint8_t keep = x_start % 2 ? 0x0F : 0xF0;
+        uint8_t value = x_start % 2 ? high : low;
+        for (int y = y_start; y < y_end; y++) {
+            *ptr = (*ptr & keep) | value;
+            ptr += line_bytes;
+        }
         return;
     }
 
-    uint8_t* buf_ptr = &framebuffer[y * epd_width() / 2 + x / 2];
-    if (x % 2) {
-        *buf_ptr = (*buf_ptr & 0x0F) | (color & 0xF0);
-    } else {
-        *buf_ptr = (*buf_ptr & 0xF0) | (color >> 4);
+    // uneven edges are not a whole byte
+    bool odd_start = x_start % 2;
+    bool odd_end = x_end % 2;
+    int bytes_start = (x_start + odd_start) / 2;
+    int bytes_len = (x_end - odd_end) / 2 - bytes_start;
+    for (int y = y_start; y < y_end; y++) {
+        if (odd_start) {
+            line[x_start / 2] = (line[x_start / 2] & 0x0F) | high;
+        }
+        if (odd_end) {
+            line[x_end / 2] = (line[x_end / 2] & 0xF0) | low;
+        }
+        if (bytes_len > 0) {
+            memset(line + bytes_start, high | low, bytes_len);
+        }
+        line += line_bytes;
+    }
+}
+
+void epd_push_clip(EpdRect clip) {
+    assert(clip_depth < EPD_MAX_CLIP_DEPTH);
+    clip_rect = intersect_rect(clip_rect, _rotate_rect(clip));
+    clip_stack[clip_depth] = clip_rect;
+    clip_depth++;
+}
+
+void epd_pop_clip() {
+    assert(clip_depth > 0);
+    clip_depth--;
+    clip_rect = clip_depth > 0 ? clip_stack[clip_depth - 1] : epd_full_screen();
+}
+
+bool epd_clip_intersects(EpdRect area) {
+    EpdRect visible = intersect_rect(current_clip(), _rotate_rect(area));
+    return visible.width > 0 && visible.height > 0;
+}
+
+void epd_draw_hline(int x, int y, int length, uint8_t color, uint8_t* framebuffer) {
+    EpdRect line = { .x = x, .y = y, .width = length, .height = 1 };
+    fill_framebuffer_rect(_rotate_rect(line), color, framebuffer);
+}
+
+void epd_draw_vline(int x, int y, int length, uint8_t color, uint8_t* framebuffer) {
+    EpdRect line = { .x = x, .y = y, .width = 1, .height = length };
+    fill_framebuffer_rect(_rotate_rect(line), color, framebuffer);
+}
+
+void epd_draw_pixel(int x, int y, uint8_t color, uint8_t* framebuffer) {
+    rotation_backend->draw_pixel(x, y, color, framebuffer);
+}
+
+void epd_draw_pixel_row(int x, int y, int len, const uint8_t* colors, uint8_t* framebuffer) {
+    EpdRect row = { .x = x, .y = y, .width = len, .height = 1 };
+    EpdRect rotated = _rotate_rect(row);
+    EpdRect visible = intersect_rect(rotated, current_clip());
+    if (visible.width == 0 || visible.height == 0) {
+        return;
+    }
+    epd_mark_damaged(framebuffer, visible);
+
+    // the row runs towards the lower framebuffer coordinates for negative steps
+    const RotationStep step = rotation_backend->step_x;
+    const int fb_width = display->width;
+    bool reverse = step.dx < 0 || step.dy < 0;
+    int row_x = reverse ? rotated.x + rotated.width - 1 : rotated.x;
+    int row_y = reverse ? rotated.y + rotated.height - 1 : rotated.y;
+    int fx = reverse ? visible.x + visible.width - 1 : visible.x;
+    int fy = reverse ? visible.y + visible.height - 1 : visible.y;
+    colors += (fx - row_x) * step.dx + (fy - row_y) * step.dy;
+
+    int pos = fy * fb_width + fx;
+    const int stride = step.dx + step.dy * fb_width;
+    const int count = visible.width * visible.height;
+    for (int i = 0; i < count; i++) {
+        uint8_t* ptr = &framebuffer[pos / 2];
+        if (pos % 2) {
+            *ptr = (*ptr & 0x0F) | (colors[i] & 0xF0);
+        } else {
+            *ptr = (*ptr & 0xF0) | (colors[i] >> 4);
+        }
+        pos += stride;
     }
 }
 
 void epd_draw_circle(int x0, int y0, int r, uint8_t color, uint8_t* framebuffer) {
+    EpdRect bounds = { .x = x0 - r, .y = y0 - r, .width = 2 * r + 1, .height = 2 * r + 1 };
+    if (!epd_clip_intersects(bounds)) {
+        return;
+    }
+
     int f = 1 - r;
     int ddF_x = 1;
     int ddF_y = -2 * r;
     int x = 0;
     int y = r;
 
-    epd_draw_pixel(x0, y0 + r, color, framebuffer);
-    epd_draw_pixel(x0, y0 - r, color, framebuffer);
-    epd_draw_pixel(x0 + r, y0, color, framebuffer);
-    epd_draw_pixel(x0 - r, y0, color, framebuffer);
+    // the points are drawn in framebuffer coordinates, relative to the center
+    int fx, fy;
+    rotate_point(x0, y0, &fx, &fy);
+    const RotationStep sx = rotation_backend->step_x;
+    const RotationStep sy = rotation_backend->step_y;
+
+    put_pixel(fx + r * sy.dx, fy + r * sy.dy, color, framebuffer);
+    put_pixel(fx - r * sy.dx, fy - r * sy.dy, color, framebuffer);
+    put_pixel(fx + r * sx.dx, fy + r * sx.dy, color, framebuffer);
+    put_pixel(fx - r * sx.dx, fy - r * sx.dy, color, framebuffer);
 
     while (x < y) {
         if (f >= 0) {
@@ -116,18 +347,28 @@ void epd_draw_circle(int x0, int y0, int r, uint8_t color, uint8_t* framebuffer)
         ddF_x += 2;
         f += ddF_x;
 
-        epd_draw_pixel(x0 + x, y0 + y, color, framebuffer);
-        epd_draw_pixel(x0 - x, y0 + y, color, framebuffer);
-        epd_draw_pixel(x0 + x, y0 - y, color, framebuffer);
-        epd_draw_pixel(x0 - x, y0 - y, color, framebuffer);
-        epd_draw_pixel(x0 + y, y0 + x, color, framebuffer);
-        epd_draw_pixel(x0 - y, y0 + x, color, framebuffer);
-        epd_draw_pixel(x0 + y, y0 - x, color, framebuffer);
-        epd_draw_pixel(x0 - y, y0 - x, color, framebuffer);
+        // offsets of (x, y) and (y, x) along the rotated axes
+        int ax = x * sx.dx + y * sy.dx, ay = x * sx.dy + y * sy.dy;
+        int bx = x * sx.dx - y * sy.dx, by = x * sx.dy - y * sy.dy;
+        int cx = y * sx.dx + x * sy.dx, cy = y * sx.dy + x * sy.dy;
+        int dx = y * sx.dx - x * sy.dx, dy = y * sx.dy - x * sy.dy;
+
+        put_pixel(fx + ax, fy + ay, color, framebuffer);
+        put_pixel(fx - bx, fy - by, color, framebuffer);
+        put_pixel(fx + bx, fy + by, color, framebuffer);
+        put_pixel(fx - ax, fy - ay, color, framebuffer);
+        put_pixel(fx + cx, fy + cy, color, framebuffer);
+        put_pixel(fx - dx, fy - dy, color, framebuffer);
+        put_pixel(fx + dx, fy + dy, color, framebuffer);
+        put_pixel(fx - cx, fy - cy, color, framebuffer);
     }
 }
 
 void epd_fill_circle(int x0, int y0, int r, uint8_t color, uint8_t* framebuffer) {
+    EpdRect bounds = { .x = x0 - r, .y = y0 - r, .width = 2 * r + 1, .height = 2 * r + 1 };
+    if (!epd_clip_intersects(bounds)) {
+        return;
+    }
     epd_draw_vline(x0, y0 - r, 2 * r + 1, color, framebuffer);
     epd_fill_circle_helper(x0, y0, r, 3, 0, color, framebuffer);
 }
@@ -185,16 +426,20 @@ void epd_draw_rect(EpdRect rect, uint8_t color, uint8_t* framebuffer) {
 }
 
 void epd_fill_rect(EpdRect rect, uint8_t color, uint8_t* framebuffer) {
-    int x = rect.x;
-    int y = rect.y;
-    int w = rect.width;
-    int h = rect.height;
-    for (int i = y; i < y + h; i++) {
-        epd_draw_hline(x, i, w, color, framebuffer);
-    }
+    fill_framebuffer_rect(_rotate_rect(rect), color, framebuffer);
 }
 
 static void epd_write_line(int x0, int y0, int x1, int y1, uint8_t color, uint8_t* framebuffer) {
+    EpdRect bounds = {
+        .x = min(x0, x1),
+        .y = min(y0, y1),
+        .width = abs(x1 - x0) + 1,
+        .height = abs(y1 - y0) + 1,
+    };
+    if (!epd_clip_intersects(bounds)) {
+        return;
+    }
+
     int steep = abs(y1 - y0) > abs(x1 - x0);
     if (steep) {
         _swap_int(x0, y0);
@@ -219,15 +464,27 @@ static void epd_write_line(int x0, int y0, int x1, int y1, uint8_t color, uint8_
         ystep = -1;
     }
 
+    // walk the line in framebuffer coordinates,
+    // along the rotated y axis for steep lines
+    int fx, fy;
+    if (steep) {
+        rotate_point(y0, x0, &fx, &fy);
+    } else {
+        rotate_point(x0, y0, &fx, &fy);
+    }
+    RotationStep major = steep ? rotation_backend->step_y : rotation_backend->step_x;
+    RotationStep minor = steep ? rotation_backend->step_x : rotation_backend->step_y;
+    int minor_dx = minor.dx * ystep;
+    int minor_dy = minor.dy * ystep;
+
     for (; x0 <= x1; x0++) {
-        if (steep) {
-            epd_draw_pixel(y0, x0, color, framebuffer);
-        } else {
-            epd_draw_pixel(x0, y0, color, framebuffer);
-        }
+        put_pixel(fx, fy, color, framebuffer);
+        fx += major.dx;
+        fy += major.dy;
         err -= dy;
         if (err < 0) {
-            y0 += ystep;
+            fx += minor_dx;
+            fy += minor_dy;
             err += dx;
         }
     }
@@ -261,6 +518,18 @@ void epd_fill_triangle(
 ) {
     int a, b, y, last;
 
+    int x_min = min(x0, min(x1, x2));
+    int y_min = min(y0, min(y1, y2));
+    EpdRect bounds = {
+        .x = x_min,
+        .y = y_min,
+        .width = max(x0, max(x1, x2)) - x_min + 1,
+        .height = max(y0, max(y1, y2)) - y_min + 1,
+    };
+    if (!epd_clip_intersects(bounds)) {
+        return;
+    }
+
     // Sort coordinates by Y order (y2 >= y1 >= y0)
     if (y0 > y1) {
         _swap_int(y0, y1);
@@ -337,33 +606,100 @@ void epd_fill_triangle(
     }
 }
 
+/// Pixel `x` of a 4bpp line, with the first pixel in the lower nibble.
+static inline uint8_t line_nibble(const uint8_t* line, int x) {
+    return x % 2 ? line[x / 2] >> 4 : line[x / 2] & 0x0F;
+}
+
+/**
+ * Copy `len` pixels from pixel `src_x` of the 4bpp line `src`
+ * to pixel `dst_x` of the framebuffer line `dst`.
+ * Whole bytes are copied if the nibble phases match, otherwise shifted by a nibble.
+ */
+static void blit_line(uint8_t* dst, int dst_x, const uint8_t* src, int src_x, int len) {
+    // make the destination byte aligned
+    if (dst_x % 2) {
+        dst[dst_x / 2] = (dst[dst_x / 2] & 0x0F) | (line_nibble(src, src_x) << 4);
+        dst_x++;
+        src_x++;
+        len--;
+    }
+
+    uint8_t* d = dst + dst_x / 2;
+    const uint8_t* s = src + src_x / 2;
+    int bytes = len / 2;
+    if (src_x % 2 == 0) {
+        memcpy(d, s, bytes);
+    } else {
+        // each destination byte takes the upper nibble of one and
+        // the lower nibble of the next source byte
+        uint8_t carry = s[0];
+        for (int i = 0; i < bytes; i++) {
+            uint8_t next = s[i + 1];
+            d[i] = (carry >> 4) | (next << 4);
+            carry = next;
+        }
+    }
+
+    if (len % 2) {
+        d[bytes] = (d[bytes] & 0xF0) | line_nibble(src, src_x + len - 1);
+    }
+}
+
 void epd_copy_to_framebuffer(EpdRect image_area, const uint8_t* image_data, uint8_t* framebuffer) {
     assert(framebuffer != NULL);
+    // the image area is in framebuffer coordinates
+    EpdRect visible = intersect_rect(image_area, current_clip());
+    if (visible.width == 0 || visible.height == 0) {
+        return;
+    }
+    epd_mark_damaged(framebuffer, visible);
 
-    for (uint32_t i = 0; i < image_area.width * image_area.height; i++) {
-        uint32_t value_index = i;
-        // for images of uneven width,
-        // consume an additional nibble per row.
-        if (image_area.width % 2) {
-            value_index += i / image_area.width;
-        }
-        uint8_t val = (value_index % 2) ? (image_data[value_index / 2] & 0xF0) >> 4
-                                        : image_data[value_index / 2] & 0x0F;
+    const int line_bytes = epd_width() / 2;
+    // images of uneven width have a padding nibble per row
+    const int image_line_bytes = image_area.width / 2 + image_area.width % 2;
+    const int src_x = visible.x - image_area.x;
+    const uint8_t* src = image_data + (visible.y - image_area.y) * image_line_bytes;
+    uint8_t* dst = framebuffer + visible.y * line_bytes;
+    for (int y = 0; y < visible.height; y++) {
+        blit_line(dst, visible.x, src, src_x, visible.width);
+        src += image_line_bytes;
+        dst += line_bytes;
+    }
+}
 
-        int xx = image_area.x + i % image_area.width;
-        if (xx < 0 || xx >= epd_width()) {
-            continue;
-        }
-        int yy = image_area.y + i / image_area.width;
-        if (yy < 0 || yy >= epd_height()) {
-            continue;
-        }
-        uint8_t* buf_ptr = &framebuffer[yy * epd_width() / 2 + xx / 2];
-        if (xx % 2) {
-            *buf_ptr = (*buf_ptr & 0x0F) | (val << 4);
-        } else {
-            *buf_ptr = (*buf_ptr & 0xF0) | val;
-        }
+int epd_damage_tiles_x() {
+    return (epd_width() + EPD_DAMAGE_TILE_SIZE - 1) / EPD_DAMAGE_TILE_SIZE;
+}
+
+int epd_damage_tiles_y() {
+    return (epd_height() + EPD_DAMAGE_TILE_SIZE - 1) / EPD_DAMAGE_TILE_SIZE;
+}
+
+void epd_track_damage(const uint8_t* framebuffer, uint8_t* dirty_tiles) {
+    assert(framebuffer == NULL || dirty_tiles != NULL);
+    damage_framebuffer = framebuffer;
+    damage_tiles = dirty_tiles;
+    damage_tiles_x = epd_damage_tiles_x();
+}
+
+void epd_mark_damaged(const uint8_t* framebuffer, EpdRect area) {
+    if (framebuffer == NULL || framebuffer != damage_framebuffer) {
+        return;
+    }
+    int x_start = max(area.x, 0);
+    int y_start = max(area.y, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    int y_end = min(area.y + area.height, epd_height());
+    if (x_start >= x_end || y_start >= y_end) {
+        return;
+    }
+
+    int tx_start = x_start / EPD_DAMAGE_TILE_SIZE;
+    int tx_end = (x_end - 1) / EPD_DAMAGE_TILE_SIZE;
+    for (int ty = y_start / EPD_DAMAGE_TILE_SIZE; ty <= (y_end - 1) / EPD_DAMAGE_TILE_SIZE;
+         ty++) {
+        memset(damage_tiles + ty * damage_tiles_x + tx_start, 1, tx_end - tx_start + 1);
     }
 }
 
@@ -380,7 +716,9 @@ enum EpdDrawError epd_draw_image(EpdRect area, const uint8_t* data, const EpdWav
 }
 
 void epd_set_rotation(enum EpdRotation rotation) {
+    assert(rotation >= EPD_ROT_LANDSCAPE && rotation <= EPD_ROT_INVERTED_PORTRAIT);
     display_rotation = rotation;
+    rotation_backend = &rotation_backends[rotation];
 }
 
 enum EpdRotation epd_get_rotation() {
@@ -438,26 +776,138 @@ uint8_t epd_get_pixel(int x, int y, int fb_width, int fb_height, const uint8_t*
     return buf_val << 4;
 }
 
+/// Edge length of the framebuffer tiles drawn by `draw_rotated_transparent_image()`.
+#define ROTATED_BLIT_TILE 16
+
+/**
+ * Draw `len` pixels to the framebuffer line `dst`, starting at pixel `dst_x`.
+ * The source pixels start at (`sx`, `sy`) of the 4bpp `image`
+ * and advance by (`dsx`, `dsy`) per pixel.
+ * Pixels of `*transparent_color` are skipped, if it is not NULL.
+ */
+static void blit_rotated_line(
+    uint8_t* dst,
+    int dst_x,
+    int len,
+    const uint8_t* image,
+    int image_line_bytes,
+    int sx,
+    int sy,
+    int dsx,
+    int dsy,
+    const uint8_t* transparent_color
+) {
+    const uint8_t* src = image + sy * image_line_bytes;
+    const int src_step = dsy * image_line_bytes;
+
+    if (transparent_color != NULL) {
+        for (int x = dst_x; x < dst_x + len; x++) {
+            uint8_t value = line_nibble(src, sx);
+            sx += dsx;
+            src += src_step;
+            if (value << 4 == *transparent_color) {
+                continue;
+            }
+            uint8_t* d = &dst[x / 2];
+            *d = x % 2 ? (*d & 0x0F) | (value << 4) : (*d & 0xF0) | value;
+        }
+        return;
+    }
+
+    int x = dst_x;
+    int x_end = dst_x + len;
+    if (x % 2 && x < x_end) {
+        dst[x / 2] = (dst[x / 2] & 0x0F) | (line_nibble(src, sx) << 4);
+        sx += dsx;
+        src += src_step;
+        x++;
+    }
+    // whole bytes of two pixels
+    for (; x + 1 < x_end; x += 2) {
+        uint8_t low = line_nibble(src, sx);
+        uint8_t high = line_nibble(src + src_step, sx + dsx);
+        dst[x / 2] = low | (high << 4);
+        sx += 2 * dsx;
+        src += 2 * src_step;
+    }
+    if (x < x_end) {
+        dst[x / 2] = (dst[x / 2] & 0xF0) | line_nibble(src, sx);
+    }
+}
+
+/**
+ * Draw an image in rotated coordinates, with an optional transparent color.
+ * The framebuffer is written in tiles of `ROTATED_BLIT_TILE` pixels,
+ * so the image lines read for the transposing rotations stay in the cache.
+ */
 static void draw_rotated_transparent_image(
     EpdRect image_area,
     const uint8_t* image_buffer,
     uint8_t* framebuffer,
     uint8_t* transparent_color
 ) {
-    uint16_t x_offset = 0;
-    uint16_t y_offset = 0;
-    uint8_t pixel_color;
-    for (uint16_t y = 0; y < image_area.height; y++) {
-        for (uint16_t x = 0; x < image_area.width; x++) {
-            x_offset = image_area.x + x;
-            y_offset = image_area.y + y;
-            if (x_offset >= epd_rotated_display_width())
-                continue;
-            if (y_offset >= epd_rotated_display_height())
-                continue;
-            pixel_color = epd_get_pixel(x, y, image_area.width, image_area.height, image_buffer);
-            if (transparent_color == NULL || pixel_color != (*transparent_color))
-                epd_draw_pixel(x_offset, y_offset, pixel_color, framebuffer);
+    EpdRect visible = intersect_rect(_rotate_rect(image_area), current_clip());
+    if (visible.width == 0 || visible.height == 0) {
+        return;
+    }
+    epd_mark_damaged(framebuffer, visible);
+
+    const int fb_width = epd_width();
+    const int fb_height = epd_height();
+    const int line_bytes = fb_width / 2;
+    // images of uneven width have a padding nibble per row
+    const int image_line_bytes = image_area.width / 2 + image_area.width % 2;
+
+    // The image pixel drawn to framebuffer pixel (px, py) is
+    // (sx_px * px + sx_py * py + sx_0, sy_px * px + sy_py * py + sy_0),
+    // the inverse of the rotation of `epd_draw_pixel()`.
+    int sx_px = 1, sx_py = 0, sx_0 = -image_area.x;
+    int sy_px = 0, sy_py = 1, sy_0 = -image_area.y;
+    switch (display_rotation) {
+        case EPD_ROT_LANDSCAPE:
+            break;
+        case EPD_ROT_PORTRAIT:
+            sx_px = 0;
+            sx_py = 1;
+            sy_px = -1;
+            sy_py = 0;
+            sy_0 = fb_width - 1 - image_area.y;
+            break;
+        case EPD_ROT_INVERTED_LANDSCAPE:
+            sx_px = -1;
+            sx_0 = fb_width - 1 - image_area.x;
+            sy_py = -1;
+            sy_0 = fb_height - 1 - image_area.y;
+            break;
+        case EPD_ROT_INVERTED_PORTRAIT:
+            sx_px = 0;
+            sx_py = -1;
+            sx_0 = fb_height - 1 - image_area.x;
+            sy_px = 1;
+            sy_py = 0;
+            break;
+    }
+
+    const int x_end = visible.x + visible.width;
+    const int y_end = visible.y + visible.height;
+    for (int ty = visible.y; ty < y_end; ty += ROTATED_BLIT_TILE) {
+        int tile_y_end = min(ty + ROTATED_BLIT_TILE, y_end);
+        for (int tx = visible.x; tx < x_end; tx += ROTATED_BLIT_TILE) {
+            int tile_width = min(ROTATED_BLIT_TILE, x_end - tx);
+            for (int py = ty; py < tile_y_end; py++) {
+                blit_rotated_line(
+                    framebuffer + py * line_bytes,
+                    tx,
+                    tile_width,
+                    image_buffer,
+                    image_line_bytes,
+                    sx_px * tx + sx_py * py + sx_0,
+                    sy_px * tx + sy_py * py + sy_0,
+                    sx_px,
+                    sy_px,
+                    transparent_color
+                );
+            }
         }
     }
 }
@@ -488,6 +938,8 @@ void epd_init(
     const EpdBoardDefinition* board, const EpdDisplay_t* disp, enum EpdInitOptions options
 ) {
     display = disp;
+    clip_depth = 0;
+    clip_rect = epd_full_screen();
     epd_set_board(board);
     epd_renderer_init(options);
 }
@@ -11,6 +11,7 @@ extern "C" {
 #include <esp_attr.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "epd_internals.h"
 
@@ -32,6 +33,7 @@ enum EpdInitOptions {
     EPD_OPTIONS_DEFAULT = 0,
     /// Use a small look-up table of 1024 bytes.
     /// The EPD driver will use less space, but performance may be worse.
+    /// Difference images (as used by the high-level API) are supported on all targets.
     EPD_LUT_1K = 1,
     /// Use a 64K lookup table. (default)
     /// Best performance, but permanently occupies a 64k block of internal memory.
@@ -43,8 +45,38 @@ enum EpdInitOptions {
     /// Use a feed queue of 32 display lines. (default)
     /// Best performance, but larger memory footprint.
     EPD_FEED_QUEUE_32 = 8,
+
+    /// Keep built lookup tables of recently used waveform frames in PSRAM
+    /// (or general purpose memory without PSRAM) and copy them in,
+    /// instead of rebuilding them for every frame of every update.
+    /// Uses up to 1MB of memory, allocated on demand.
+    /// With 64K LUTs, this holds 16 frames: Of modes with more frames,
+    /// the first 16 frames are cached.
+    EPD_LUT_CACHE = 16,
+
+    /// Bits holding the number of render worker tasks, see `EPD_RENDER_WORKERS()`.
+    EPD_RENDER_WORKERS_MASK = 0xF00,
+    /// Pin all render workers to core 0, to keep core 1 free for the application.
+    /// By default, worker `i` is pinned to core `i % portNUM_PROCESSORS`.
+    EPD_RENDER_CORE_0 = 0x1000,
+    /// Pin all render workers to core 1, to keep core 0 free for the application.
+    EPD_RENDER_CORE_1 = 0x2000,
+    /// Let the scheduler run render workers on any core.
+    EPD_RENDER_NO_AFFINITY = 0x3000,
 };
 
+/**
+ * Init option for using `n` (1 to 15) render worker tasks. (default: 2)
+ *
+ * More workers prepare lines faster, if there are enough cores to run them.
+ * The I2S render method uses at least 2 tasks, since one of them outputs
+ * the lines prepared by the others.
+ */
+#define EPD_RENDER_WORKERS(n) ((enum EpdInitOptions)(((n) & 0xF) << 8))
+
+/// Maximum number of render workers, see `EPD_RENDER_WORKERS()`.
+#define EPD_MAX_RENDER_WORKERS 15
+
 /// The image drawing mode.
 enum EpdDrawMode {
     /// An init waveform.
@@ -99,7 +131,12 @@ enum EpdDrawMode {
     /// The upper nibble marks the "from" color,
     /// the lower nibble the "to" color.
     MODE_PACKING_1PPB_DIFFERENCE = 0x100,
-    // reserver for 4PPB mode
+    /// 2 bit-per-pixel framebuffer with 0x0 = black, 0x3 = white,
+    /// which correspond to the 4bpp gray levels 0x0, 0x5, 0xA and 0xF.
+    /// The lowest two bits correspond to the leftmost pixel.
+    /// Requires `PREVIOUSLY_WHITE`, `PREVIOUSLY_BLACK` or drawing the difference
+    /// to a previous 2bpp framebuffer with `epd_draw_difference()`.
+    MODE_PACKING_4PPB = 0x1000,
 
     /// Assert that the display has a uniform color, e.g. after initialization.
     /// If `MODE_PACKING_2PPB` is specified, a optimized output calculation can be used.
@@ -196,6 +233,12 @@ typedef struct {
     enum EpdFontFlags flags;
 } EpdFontProperties;
 
+/// The set of gray level transitions present in an update.
+typedef struct {
+    /// Bit `from` of `to_from[to]` is set if a drawn pixel goes from gray level `from` to `to`.
+    uint16_t to_from[16];
+} EpdTransitions;
+
 #include "epd_board.h"
 #include "epd_board_specific.h"
 #include "epd_display.h"
@@ -303,6 +346,45 @@ void epd_copy_to_framebuffer(EpdRect image_area, const uint8_t* image_data, uint
  */
 void epd_draw_pixel(int x, int y, uint8_t color, uint8_t* framebuffer);
 
+/**
+ * Draw a row of pixels with individual colors to a given framebuffer.
+ * The row is clipped once and written with a constant framebuffer stride,
+ * which is faster than drawing the pixels one by one.
+ *
+ * @param x: Horizontal position of the first pixel in pixels.
+ * @param y: Vertical position of the row in pixels.
+ * @param len: The number of pixels to draw.
+ * @param colors: The gray values of the pixels, `len` bytes (see [Colors](#Colors)).
+ * @param framebuffer: The framebuffer to draw to,
+ */
+void epd_draw_pixel_row(int x, int y, int len, const uint8_t* colors, uint8_t* framebuffer);
+
+/// Maximum number of nested clip rectangles, see `epd_push_clip()`.
+#define EPD_MAX_CLIP_DEPTH 8
+
+/**
+ * Restrict all drawing functions to `clip`, in addition to the current clip rectangle.
+ * Clip rectangles form a stack, restore the previous one with `epd_pop_clip()`.
+ * This allows redrawing only the damaged part of a widget,
+ * without touching the rest of the framebuffer.
+ *
+ * @param clip: The clip rectangle in rotated display coordinates.
+ *      It is converted to framebuffer coordinates with the rotation at the time of the call.
+ */
+void epd_push_clip(EpdRect clip);
+
+/**
+ * Restore the clip rectangle before the last `epd_push_clip()`.
+ * Without clip rectangles, drawing is only limited to the display.
+ */
+void epd_pop_clip();
+
+/**
+ * Whether any pixel of `area` in rotated display coordinates is inside
+ * the current clip rectangle. Drawing functions use this to skip invisible shapes.
+ */
+bool epd_clip_intersects(EpdRect area);
+
 /**
  * Draw a horizontal line to a given framebuffer.
  *
@@ -492,6 +574,21 @@ const EpdGlyph* epd_get_glyph(const EpdFont* font, uint32_t code_point);
  */
 void epd_push_pixels(EpdRect area, short time, int color);
 
+/// Optional additional information for `epd_draw_base_with_options()`.
+typedef struct {
+    /// If not NULL, the image data is a 4bpp (or 2bpp with `MODE_PACKING_4PPB`) framebuffer,
+    /// which is drawn as difference to this previous framebuffer. See `epd_draw_difference()`.
+    const uint8_t* from;
+    /// If not NULL, the gray level transitions present in the drawn pixels,
+    /// e.g. from `epd_difference_image_transitions()`.
+    /// Frames in which none of these transitions drives a pixel are skipped,
+    /// and the update ends after the last frame which drives any of them.
+    const EpdTransitions* transitions;
+    /// If not NULL, the transitions present in each line, indexed like `drawn_lines`.
+    /// Lines are output as no-op lines once none of their transitions is driven anymore.
+    const EpdTransitions* line_transitions;
+} EpdDrawOptions;
+
 /**
  * Base function for drawing an image on the screen.
  * If It is very customizable, and the documentation below should be studied carefully.
@@ -529,6 +626,53 @@ enum EpdDrawError epd_draw_base(
     const uint8_t* drawn_columns,
     const EpdWaveform* waveform
 );
+/**
+ * Like `epd_draw_base()`, but with additional options.
+ *
+ * @param options: Additional information about the update, may be NULL.
+ */
+enum EpdDrawError epd_draw_base_with_options(
+    EpdRect area,
+    const uint8_t* data,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform,
+    const EpdDrawOptions* options
+);
+
+/**
+ * Draw the difference between two 4bpp (`MODE_PACKING_2PPB`) framebuffers.
+ * This is equivalent to drawing the result of `epd_difference_image()` with
+ * `MODE_PACKING_1PPB_DIFFERENCE`, but the difference is calculated on the fly
+ * by the render threads for every frame, so no difference image needs to be stored.
+ *
+ * If `mode` contains `MODE_PACKING_4PPB`, both framebuffers are 2bpp instead,
+ * see `epd_difference_4ppb_cropped()` for calculating the changed lines and columns.
+ *
+ * @param area: The area of the screen to draw to. Must span the full display width.
+ * @param to: The goal image as 4bpp framebuffer.
+ * @param from: The previous image as 4bpp framebuffer, with the same 16 byte alignment as `to`.
+ * @param mode: The waveform mode and additional flags.
+ *      The packing mode is ignored, unless it is `MODE_PACKING_4PPB`.
+ *
+ * See `epd_draw_base()` for the remaining parameters.
+ * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags otherwise.
+ */
+enum EpdDrawError epd_draw_difference(
+    EpdRect area,
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform
+);
+
 /**
  * Calculate a `MODE_PACKING_1PPB_DIFFERENCE` difference image
  * from two `MODE_PACKING_2PPB` (4 bit-per-pixel) buffers.
@@ -539,6 +683,10 @@ enum EpdDrawError epd_draw_base(
  * @param crop_to: Only calculate the difference for a crop of the input framebuffers.
  *      The `interlaced` will not be modified outside the crop area.
  * @param interlaced: The resulting difference image in `MODE_PACKING_1PPB_DIFFERENCE` format.
+ *      Lines without differences are not written and keep their previous data,
+ *      so only the lines marked in `dirty_lines` should be drawn.
+ *      If NULL, only `dirty_lines` and `col_dirtyness` are calculated,
+ *      e.g. for drawing with `epd_draw_difference()`.
  * @param dirty_lines: An array of at least `epd_height()`.
  *      The positions corresponding to lines where `to` and `from` differ
  *      are set to `true`, otherwise to `false`.
@@ -556,6 +704,29 @@ EpdRect epd_difference_image_cropped(
     uint8_t* col_dirtiness
 );
 
+/**
+ * Like `epd_difference_image_cropped()`, but also collects the gray level transitions
+ * of the dirty lines while calculating the difference, for skipping the waveform frames
+ * and line outputs which do not drive any of them, see `EpdDrawOptions`.
+ * The transitions of all pixels in dirty lines are collected,
+ * which includes the pixels in the dirty columns.
+ *
+ * @param transitions: If not NULL, receives the transitions of all dirty lines.
+ * @param line_transitions: If not NULL, an array of `epd_height()` entries
+ *      receiving the transitions of each line in the crop area.
+ *      The entries of lines which are not dirty are cleared.
+ */
+EpdRect epd_difference_image_transitions(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtiness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+);
+
 /**
  * Simplified version of `epd_difference_image_cropped()`, which considers the
  * whole display frame buffer.
@@ -570,6 +741,56 @@ EpdRect epd_difference_image(
     uint8_t* col_dirtiness
 );
 
+/**
+ * Like `epd_difference_image_cropped()`, but only looks at the tiles
+ * marked in `dirty_tiles` (see `epd_track_damage()`).
+ * Outside of these tiles, `to` and `from` are assumed to be equal.
+ *
+ * Within the crop area, the difference is calculated for whole tile columns
+ * containing at least one dirty tile, on all lines of tile rows containing at least one dirty tile.
+ * Lines and columns which are not considered are not marked as dirty,
+ * so stale data in `interlaced` outside of these is never drawn.
+ * Displays up to 4096 pixels wide are supported.
+ *
+ * @param dirty_tiles: The dirty tile map, as described for `epd_track_damage()`.
+ * @param transitions: If not NULL, receives the transitions of the considered pixels
+ *      in dirty lines, see `epd_difference_image_transitions()`.
+ * @param line_transitions: If not NULL, receives the transitions of each line in the crop area,
+ *      see `epd_difference_image_transitions()`.
+ * @returns The smallest rectangle containing all changed pixels.
+ */
+EpdRect epd_difference_image_tiles(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const uint8_t* dirty_tiles,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtiness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+);
+
+/**
+ * Find the lines and columns where two 2bpp (`MODE_PACKING_4PPB`) framebuffers differ,
+ * e.g. for drawing them with `epd_draw_difference()`.
+ *
+ * @param to: The goal image as 2bpp framebuffer.
+ * @param from: The previous image as 2bpp framebuffer.
+ * @param crop_to: Only compare a crop of the input framebuffers.
+ * @param dirty_lines: An array of at least `epd_height()`, see `epd_difference_image_cropped()`.
+ * @param col_dirtiness: An array of at least `epd_width() / 2`, with one nibble per column
+ *      as for `epd_difference_image_cropped()`.
+ * @returns The smallest rectangle containing all changed pixels.
+ */
+EpdRect epd_difference_4ppb_cropped(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    bool* dirty_lines,
+    uint8_t* col_dirtiness
+);
+
 /**
  * Return the pixel color of a 4 bit image array
  * x,y coordinates of the image pixel
@@ -579,18 +800,49 @@ EpdRect epd_difference_image(
 uint8_t epd_get_pixel(int x, int y, int fb_width, int fb_height, const uint8_t* framebuffer);
 
 /**
- * Draw an image reading pixel per pixel and being rotation aware (via epd_draw_pixel)
+ * Draw an image in rotated display coordinates, respecting the clip rectangle.
+ * In landscape orientation, this is the same as `epd_copy_to_framebuffer()`.
  */
 void epd_draw_rotated_image(EpdRect image_area, const uint8_t* image_buffer, uint8_t* framebuffer);
 
 /**
- * Draw an image reading pixel per pixel and being rotation aware (via epd_draw_pixel)
- * With an optional transparent color (color key transparency)
+ * Like `epd_draw_rotated_image()`, but pixels of `transparent_color`
+ * (color key transparency, as returned by `epd_get_pixel()`) are not drawn.
  */
 void epd_draw_rotated_transparent_image(
     EpdRect image_area, const uint8_t* image_buffer, uint8_t* framebuffer, uint8_t transparent_color
 );
 
+/// Edge length of the square tiles used for framebuffer damage tracking, in pixels.
+#define EPD_DAMAGE_TILE_SIZE 32
+
+/// Number of damage tracking tiles per row of the (unrotated) display.
+int epd_damage_tiles_x();
+
+/// Number of damage tracking tile rows of the (unrotated) display.
+int epd_damage_tiles_y();
+
+/**
+ * Track which tiles of a framebuffer are modified by the drawing functions.
+ * Only one framebuffer can be tracked at a time.
+ *
+ * @param framebuffer: The framebuffer to track. Pass `NULL` to disable tracking.
+ * @param dirty_tiles: The tile map, one byte per `EPD_DAMAGE_TILE_SIZE`² tile,
+ *      `epd_damage_tiles_x() * epd_damage_tiles_y()` bytes in row-major order.
+ *      Drawing to a tile sets its byte to a non-zero value. Clearing it is up to the caller.
+ */
+void epd_track_damage(const uint8_t* framebuffer, uint8_t* dirty_tiles);
+
+/**
+ * Mark an area of the tracked framebuffer as modified.
+ * Use this after writing to the framebuffer memory directly.
+ * Does nothing if `framebuffer` is not the one tracked with `epd_track_damage()`.
+ *
+ * @param framebuffer: The framebuffer that was modified.
+ * @param area: The modified area in unrotated display coordinates.
+ */
+void epd_mark_damaged(const uint8_t* framebuffer, EpdRect area);
+
 /**
  * Override the pixel clock when using the LCD driver for display output (Epdiy V7+).
  * This may result in draws failing if it's set too high!
@@ -600,6 +852,111 @@ void epd_draw_rotated_transparent_image(
  */
 void epd_set_lcd_pixel_clock_MHz(int frequency);
 
+/// Number of waveform frames with individual statistics in `EpdRenderStats`.
+#define EPD_STATS_MAX_FRAMES 64
+/// Number of queue underruns recorded with their position in `EpdRenderStats`.
+#define EPD_STATS_MAX_UNDERRUNS 16
+
+/// Statistics of a single waveform frame of an update.
+typedef struct {
+    /// Time spent building the LUT of this frame in us.
+    uint32_t lut_build_us;
+    /// Time from starting the render workers until the frame was output, in us.
+    /// Zero for frames which were skipped as they drive no pixels.
+    uint32_t frame_us;
+    /// CPU cycles spent passing lines to the output peripheral:
+    /// In the line ISR with the LCD render method, in the output task with I2S.
+    uint32_t output_cycles;
+} EpdFrameStats;
+
+/// A line which was not prepared in time for output.
+typedef struct {
+    uint16_t frame;
+    uint16_t line;
+} EpdUnderrun;
+
+/// Statistics of the render pipeline during the last update.
+typedef struct {
+    /// Number of frames output.
+    int frames;
+    /// Statistics of the first `EPD_STATS_MAX_FRAMES` frames, by waveform frame index.
+    EpdFrameStats frame[EPD_STATS_MAX_FRAMES];
+
+    /// Number of render workers.
+    int workers;
+    /// Time each render worker spent on frames in us, including waits.
+    uint32_t feed_us[EPD_MAX_RENDER_WORKERS];
+    /// Time each render worker waited for space in its line queue, in us.
+    uint32_t feed_wait_us[EPD_MAX_RENDER_WORKERS];
+
+    /// Number of lines each line queue can hold.
+    int queue_capacity;
+    /// Lowest number of prepared lines in a queue when outputting a line.
+    int queue_min;
+    /// Average number of prepared lines in a queue when outputting a line.
+    float queue_avg;
+
+    /// Number of lines output, summed over all frames.
+    /// Lines skipped above the drawn ones with gate clock pulses are not counted.
+    int lines_output;
+    /// Number of lines looked up in the waveform LUT, summed over all frames.
+    int lines_driven;
+    /// Number of lines output as no-op lines without a lookup, summed over all frames.
+    int lines_skipped;
+
+    /// Number of frame LUTs copied from the cache with `EPD_LUT_CACHE`.
+    int lut_cache_hits;
+    /// Number of frame LUTs built and stored in the cache with `EPD_LUT_CACHE`.
+    int lut_cache_misses;
+
+    /// Number of lines which were not prepared in time.
+    /// With the LCD render method, these lines are output as no-op lines and the update
+    /// fails with `EPD_DRAW_EMPTY_LINE_QUEUE`. Other render methods delay the output instead.
+    int underruns;
+    /// The first `EPD_STATS_MAX_UNDERRUNS` underruns.
+    EpdUnderrun underrun[EPD_STATS_MAX_UNDERRUNS];
+} EpdRenderStats;
+
+/**
+ * Get statistics of the render pipeline during the last update,
+ * e.g. for tuning the pixel clock and queue length.
+ *
+ * The statistics are overwritten by the next update.
+ */
+const EpdRenderStats* epd_get_render_stats();
+
+/**
+ * Start recording the steps of the update pipeline, for finding stalls between
+ * the update task, the render workers and the line output.
+ *
+ * Events are recorded in a ring buffer of `num_events` events of 16 bytes
+ * in internal memory, overwriting the oldest events when full.
+ * Tracing is disabled by default, and almost free while disabled.
+ *
+ * @returns false if the buffer could not be allocated.
+ */
+bool epd_trace_start(int num_events);
+
+/// Stop recording. The recorded events are kept until `epd_trace_free()`.
+void epd_trace_stop();
+
+/// Stop recording and free the event buffer.
+void epd_trace_free();
+
+/// Number of events in the event buffer.
+int epd_trace_event_count();
+
+/**
+ * Write the recorded events as Chrome trace JSON,
+ * for viewing in chrome://tracing or https://ui.perfetto.dev.
+ * Events are grouped by CPU core, with a track for each task and the line ISR.
+ *
+ * Call `epd_trace_stop()` first.
+ *
+ * @param out: Where to write, e.g. `stdout` for the serial console.
+ */
+void epd_trace_write_json(FILE* out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,9 @@ static utf_t* utf[] = {
     &(utf_t){ 0 },
 };
 
+/// Maximum number of glyph pixels drawn with one `epd_draw_pixel_row()`.
+#define GLYPH_RUN_LENGTH 64
+
 static inline int min(int x, int y) {
     return x < y ? x : y;
 }
@@ -148,6 +151,18 @@ static enum EpdDrawError IRAM_ATTR draw_char(
     uint16_t width = glyph->width, height = glyph->height;
     int left = glyph->left;
 
+    // glyphs outside of the clip rectangle are not even decompressed
+    EpdRect glyph_area = {
+        .x = *cursor_x + left,
+        .y = cursor_y - glyph->top,
+        .width = width,
+        .height = height,
+    };
+    if (!epd_clip_intersects(glyph_area)) {
+        *cursor_x += glyph->advance_x;
+        return EPD_DRAW_SUCCESS;
+    }
+
     int byte_width = (width / 2 + width % 2);
     unsigned long bitmap_size = byte_width * height;
     const uint8_t* bitmap = NULL;
@@ -170,27 +185,31 @@ static enum EpdDrawError IRAM_ATTR draw_char(
     }
     bool background_needed = props->flags & EPD_DRAW_BACKGROUND;
 
+    // pixels are drawn in rows, interrupted by transparent pixels
+    uint8_t run[GLYPH_RUN_LENGTH];
     for (int y = 0; y < height; y++) {
         int yy = cursor_y - glyph->top + y;
         int start_pos = *cursor_x + left;
-        bool byte_complete = start_pos % 2;
         int x = max(0, -start_pos);
         int max_x = start_pos + width;
-        uint8_t color;
+        int run_len = 0;
 
-        for (int xx = start_pos; xx < max_x; xx++) {
+        for (int xx = start_pos; xx < max_x; xx++, x++) {
             uint8_t bm = bitmap[y * byte_width + x / 2];
             if ((x & 1) == 0) {
                 bm = bm & 0xF;
             } else {
                 bm = bm >> 4;
             }
-            if (background_needed || bm) {
-                color = color_lut[bm] << 4;
-                epd_draw_pixel(xx, yy, color, buffer);
+            bool drawn = background_needed || bm;
+            if (drawn) {
+                run[run_len++] = color_lut[bm] << 4;
+            }
+            if (run_len > 0 && (!drawn || xx + 1 == max_x || run_len == GLYPH_RUN_LENGTH)) {
+                int run_end = drawn ? xx + 1 : xx;
+                epd_draw_pixel_row(run_end - run_len, yy, run_len, run, buffer);
+                run_len = 0;
             }
-            byte_complete = !byte_complete;
-            x++;
         }
     }
     if (bitmap_size > 0 && font->compressed) {
@@ -380,9 +399,13 @@ static enum EpdDrawError epd_write_line(
 
     uint8_t bg = props.bg_color;
     if (props.flags & EPD_DRAW_BACKGROUND) {
-        for (int l = local_cursor_y - font->ascender; l < local_cursor_y - font->descender; l++) {
-            epd_draw_hline(local_cursor_x, l, w, bg << 4, buffer);
-        }
+        EpdRect background = {
+            .x = local_cursor_x,
+            .y = local_cursor_y - font->ascender,
+            .width = w,
+            .height = font->ascender - font->descender,
+        };
+        epd_fill_rect(background, bg << 4, buffer);
     }
     enum EpdDrawError err = EPD_DRAW_SUCCESS;
     while ((c = next_cp((const uint8_t**)&string))) {
@@ -11,6 +11,7 @@
 
 #include "epd_highlevel.h"
 #include "epdiy.h"
+#include "output_common/trace.h"
 
 #ifndef _swap_int
 #define _swap_int(a, b) \
@@ -21,9 +22,20 @@
     }
 #endif
 
+static inline int min(int x, int y) {
+    return x < y ? x : y;
+}
+static inline int max(int x, int y) {
+    return x > y ? x : y;
+}
+
 static bool already_initialized = 0;
 
 EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
+    return epd_hl_init_with_options(waveform, EPD_HL_DEFAULT);
+}
+
+EpdiyHighlevelState epd_hl_init_with_options(const EpdWaveform* waveform, int options) {
     assert(!already_initialized);
     if (waveform == NULL) {
         waveform = epd_get_display()->default_waveform;
@@ -41,10 +53,16 @@ EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
     assert(state.back_fb != NULL);
     state.front_fb = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
     assert(state.front_fb != NULL);
-    state.difference_fb = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_SPIRAM);
-    assert(state.difference_fb != NULL);
+    state.difference_fb = NULL;
+    if (!(options & EPD_HL_ON_THE_FLY_DIFFERENCE)) {
+        state.difference_fb = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_SPIRAM);
+        assert(state.difference_fb != NULL);
+    }
     state.dirty_lines = malloc(epd_height() * sizeof(bool));
     assert(state.dirty_lines != NULL);
+    state.line_transitions
+        = heap_caps_malloc(epd_height() * sizeof(EpdTransitions), MALLOC_CAP_SPIRAM);
+    assert(state.line_transitions != NULL);
     state.dirty_columns
         = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
     assert(state.dirty_columns != NULL);
@@ -53,10 +71,34 @@ EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
     memset(state.front_fb, 0xFF, fb_size);
     memset(state.back_fb, 0xFF, fb_size);
 
+    state.dirty_tiles = NULL;
+    if (options & EPD_HL_TRACK_DAMAGE) {
+        int num_tiles = epd_damage_tiles_x() * epd_damage_tiles_y();
+        state.dirty_tiles = calloc(num_tiles, 1);
+        assert(state.dirty_tiles != NULL);
+        epd_track_damage(state.front_fb, state.dirty_tiles);
+    }
+
     already_initialized = true;
     return state;
 }
 
+void epd_hl_deinit(EpdiyHighlevelState* state) {
+    assert(state != NULL);
+    if (state->dirty_tiles != NULL) {
+        epd_track_damage(NULL, NULL);
+        free(state->dirty_tiles);
+    }
+    heap_caps_free(state->back_fb);
+    heap_caps_free(state->front_fb);
+    heap_caps_free(state->difference_fb);
+    free(state->dirty_lines);
+    heap_caps_free(state->line_transitions);
+    heap_caps_free(state->dirty_columns);
+    memset(state, 0, sizeof(EpdiyHighlevelState));
+    already_initialized = false;
+}
+
 uint8_t* epd_hl_get_framebuffer(EpdiyHighlevelState* state) {
     assert(state != NULL);
     return state->front_fb;
@@ -102,6 +144,58 @@ EpdRect _inverse_rotated_area(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
     return rotated;
 }
 
+/**
+ * Copy the lines of the dirty tiles in `area` which were updated
+ * from the front to the back buffer and clear the tiles completely contained
+ * in the vertical extent of `area`.
+ */
+static void sync_dirty_tiles(EpdiyHighlevelState* state, EpdRect area) {
+    const int tiles_x = epd_damage_tiles_x();
+    const int fb_width = epd_width();
+
+    int x_start = max(area.x, 0);
+    int y_start = max(area.y, 0);
+    int x_end = min(area.x + area.width, fb_width);
+    int y_end = min(area.y + area.height, epd_height());
+    if (x_start >= x_end || y_start >= y_end) {
+        return;
+    }
+
+    int tx_start = x_start / EPD_DAMAGE_TILE_SIZE;
+    int tx_end = (x_end - 1) / EPD_DAMAGE_TILE_SIZE + 1;
+    int ty_start = y_start / EPD_DAMAGE_TILE_SIZE;
+    int ty_end = (y_end - 1) / EPD_DAMAGE_TILE_SIZE + 1;
+
+    for (int ty = ty_start; ty < ty_end; ty++) {
+        uint8_t* row = state->dirty_tiles + ty * tiles_x;
+        int line_start = max(ty * EPD_DAMAGE_TILE_SIZE, y_start);
+        int line_end = min((ty + 1) * EPD_DAMAGE_TILE_SIZE, y_end);
+
+        for (int l = line_start; l < line_end; l++) {
+            if (!state->dirty_lines[l]) {
+                continue;
+            }
+            uint8_t* lfb = state->front_fb + fb_width / 2 * l;
+            uint8_t* lbb = state->back_fb + fb_width / 2 * l;
+            for (int tx = tx_start; tx < tx_end; tx++) {
+                if (row[tx]) {
+                    int x = tx * EPD_DAMAGE_TILE_SIZE;
+                    int len = min(x + EPD_DAMAGE_TILE_SIZE, fb_width) - x;
+                    memcpy(lbb + x / 2, lfb + x / 2, len / 2);
+                }
+            }
+        }
+
+        // tiles partially outside of the area still have un-synced lines
+        bool fully_synced = line_start == ty * EPD_DAMAGE_TILE_SIZE
+                            && (line_end == (ty + 1) * EPD_DAMAGE_TILE_SIZE
+                                || line_end == epd_height());
+        if (fully_synced) {
+            memset(row + tx_start, 0, tx_end - tx_start);
+        }
+    }
+}
+
 enum EpdDrawError epd_hl_update_area(
     EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area
 ) {
@@ -116,71 +210,110 @@ enum EpdDrawError epd_hl_update_area(
     area.height = rotated_area.height;
 
     uint32_t ts = esp_timer_get_time() / 1000;
+    uint32_t trace_start = epd_trace_begin();
 
     // FIXME: use crop information here, if available
-    EpdRect diff_area = epd_difference_image_cropped(
-        state->front_fb,
-        state->back_fb,
-        area,
-        state->difference_fb,
-        state->dirty_lines,
-        state->dirty_columns
-    );
+    EpdRect diff_area;
+    if (state->dirty_tiles != NULL) {
+        diff_area = epd_difference_image_tiles(
+            state->front_fb,
+            state->back_fb,
+            area,
+            state->dirty_tiles,
+            state->difference_fb,
+            state->dirty_lines,
+            state->dirty_columns,
+            &state->transitions,
+            state->line_transitions
+        );
+    } else {
+        // the transitions allow skipping waveform frames which do not affect any changed pixel
+        diff_area = epd_difference_image_transitions(
+            state->front_fb,
+            state->back_fb,
+            area,
+            state->difference_fb,
+            state->dirty_lines,
+            state->dirty_columns,
+            &state->transitions,
+            state->line_transitions
+        );
+    }
+
+    epd_trace_end(EPD_TRACE_DIFF, EPD_TRACE_TRACK_UPDATE, diff_area.height, trace_start);
 
     if (diff_area.height == 0 || diff_area.width == 0) {
+        if (state->dirty_tiles != NULL) {
+            sync_dirty_tiles(state, area);
+        }
         return EPD_DRAW_SUCCESS;
     }
 
     uint32_t t1 = esp_timer_get_time() / 1000;
 
+    // Only drive the band of changed lines. Columns are limited by the column mask,
+    // since the renderer always works on full lines.
     diff_area.x = 0;
-    diff_area.y = 0;
     diff_area.width = epd_width();
-    diff_area.height = epd_height();
 
-    enum EpdDrawError err = EPD_DRAW_SUCCESS;
-    err = epd_draw_base(
+    EpdDrawOptions options = {
+        .from = NULL,
+        .transitions = &state->transitions,
+        .line_transitions = state->line_transitions,
+    };
+    const uint8_t* draw_data = state->difference_fb;
+    if (state->difference_fb != NULL) {
+        mode |= MODE_PACKING_1PPB_DIFFERENCE;
+    } else {
+        options.from = state->back_fb;
+        draw_data = state->front_fb;
+    }
+
+    enum EpdDrawError err = epd_draw_base_with_options(
         epd_full_screen(),
-        state->difference_fb,
+        draw_data,
         diff_area,
-        MODE_PACKING_1PPB_DIFFERENCE | mode,
+        mode,
         temperature,
         state->dirty_lines,
         state->dirty_columns,
-        state->waveform
+        state->waveform,
+        &options
     );
 
     uint32_t t2 = esp_timer_get_time() / 1000;
+    trace_start = epd_trace_begin();
 
-    diff_area.x = 0;
-    diff_area.y = 0;
-    diff_area.width = epd_width();
-    diff_area.height = epd_height();
+    if (state->dirty_tiles != NULL) {
+        sync_dirty_tiles(state, area);
+    } else {
+        int buf_width = epd_width();
 
-    int buf_width = epd_width();
+        for (int l = diff_area.y; l < diff_area.y + diff_area.height; l++) {
+            if (state->dirty_lines[l] > 0) {
+                uint8_t* lfb = state->front_fb + buf_width / 2 * l;
+                uint8_t* lbb = state->back_fb + buf_width / 2 * l;
 
-    for (int l = diff_area.y; l < diff_area.y + diff_area.height; l++) {
-        if (state->dirty_lines[l] > 0) {
-            uint8_t* lfb = state->front_fb + buf_width / 2 * l;
-            uint8_t* lbb = state->back_fb + buf_width / 2 * l;
+                int x = diff_area.x;
+                int x_last = diff_area.x + diff_area.width - 1;
 
-            int x = diff_area.x;
-            int x_last = diff_area.x + diff_area.width - 1;
+                if (x % 2) {
+                    *(lbb + x / 2) = (*(lfb + x / 2) & 0xF0) | (*(lbb + x / 2) & 0x0F);
+                    x += 1;
+                }
 
-            if (x % 2) {
-                *(lbb + x / 2) = (*(lfb + x / 2) & 0xF0) | (*(lbb + x / 2) & 0x0F);
-                x += 1;
-            }
+                if (!(x_last % 2)) {
+                    *(lbb + x_last / 2)
+                        = (*(lfb + x_last / 2) & 0x0F) | (*(lbb + x_last / 2) & 0xF0);
+                    x_last -= 1;
+                }
 
-            if (!(x_last % 2)) {
-                *(lbb + x_last / 2) = (*(lfb + x_last / 2) & 0x0F) | (*(lbb + x_last / 2) & 0xF0);
-                x_last -= 1;
+                memcpy(lbb + (x / 2), lfb + (x / 2), (x_last - x + 1) / 2);
             }
-
-            memcpy(lbb + (x / 2), lfb + (x / 2), (x_last - x + 1) / 2);
         }
     }
 
+    epd_trace_end(EPD_TRACE_BUFFER_SYNC, EPD_TRACE_TRACK_UPDATE, diff_area.height, trace_start);
     uint32_t t3 = esp_timer_get_time() / 1000;
 
     ESP_LOGI(
@@ -194,10 +327,18 @@ enum EpdDrawError epd_hl_update_area(
     return err;
 }
 
+void epd_hl_mark_dirty(EpdiyHighlevelState* state, EpdRect area) {
+    assert(state != NULL);
+    epd_mark_damaged(
+        state->front_fb, _inverse_rotated_area(area.x, area.y, area.width, area.height)
+    );
+}
+
 void epd_hl_set_all_white(EpdiyHighlevelState* state) {
     assert(state != NULL);
     int fb_size = epd_width() / 2 * epd_height();
     memset(state->front_fb, 0xFF, fb_size);
+    epd_mark_damaged(state->front_fb, epd_full_screen());
 }
 
 void epd_fullclear(EpdiyHighlevelState* state, int temperature) {
@@ -205,6 +346,7 @@ void epd_fullclear(EpdiyHighlevelState* state, int temperature) {
     epd_hl_set_all_white(state);
     enum EpdDrawError err = epd_hl_update_screen(state, MODE_GC16, temperature);
     assert(err == EPD_DRAW_SUCCESS);
+    (void)err;
     epd_clear();
 }
 
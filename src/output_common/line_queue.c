@@ -62,21 +62,42 @@ void IRAM_ATTR lq_commit(LineQueue_t* queue) {
     }
 }
 
-int IRAM_ATTR lq_read(LineQueue_t* queue, uint8_t* dst) {
+int IRAM_ATTR lq_free_slots(LineQueue_t* queue) {
+    int current = atomic_load_explicit(&queue->current, memory_order_acquire);
+    int last = atomic_load_explicit(&queue->last, memory_order_acquire);
+
+    // one slot is always kept free to tell a full queue from an empty one
+    return (last - current - 1 + queue->size) % queue->size;
+}
+
+const uint8_t* IRAM_ATTR lq_peek(LineQueue_t* queue) {
     int current = atomic_load_explicit(&queue->current, memory_order_acquire);
     int last = atomic_load_explicit(&queue->last, memory_order_acquire);
 
     if (current == last) {
-        return -1;
+        return NULL;
     }
+    return queue->bufs[last];
+}
 
-    memcpy(dst, queue->bufs[last], queue->element_size);
+void IRAM_ATTR lq_release(LineQueue_t* queue) {
+    int last = atomic_load_explicit(&queue->last, memory_order_acquire);
 
     if (last == queue->size - 1) {
         queue->last = 0;
     } else {
         atomic_fetch_add(&queue->last, 1);
     }
+}
+
+int IRAM_ATTR lq_read(LineQueue_t* queue, uint8_t* dst) {
+    const uint8_t* line = lq_peek(queue);
+    if (line == NULL) {
+        return -1;
+    }
+
+    memcpy(dst, line, queue->element_size);
+    lq_release(queue);
     return 0;
 }
 
@@ -35,6 +35,22 @@ void lq_commit(LineQueue_t* queue);
 /// Returns 0 for a successful read to `dst`, -1 for a failed read (empty queue).
 int lq_read(LineQueue_t* queue, uint8_t* dst);
 
+/// Number of elements that can currently be committed to the queue.
+int lq_free_slots(LineQueue_t* queue);
+
+/// Pointer to the oldest element in the line queue, without copying it.
+/// The element stays valid and is not overwritten until `lq_release()`.
+///
+/// Only the I2S and host outputs use the element in place. The LCD output
+/// is not zero-copy: its DMA descriptors point at bounce buffers owned by
+/// the LCD driver, so every line is still copied out of the queue slot.
+///
+/// NULL if the queue is currently empty.
+const uint8_t* lq_peek(LineQueue_t* queue);
+
+/// Remove the element returned by `lq_peek()` from the queue.
+void lq_release(LineQueue_t* queue);
+
 /// Reset the queue into an empty state.
 /// This operation is *not* atomic!
 void lq_reset(LineQueue_t* queue);
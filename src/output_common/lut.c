@@ -121,6 +121,20 @@ nibble_shift_buffer_right(uint8_t* buf, uint32_t len) {
     }
 }
 
+/**
+ * Shift a 2bpp buffer by `shift` pixels to the right, filling in white pixels.
+ */
+__attribute__((optimize("O3"))) void IRAM_ATTR
+crumb_shift_buffer_right(uint8_t* buf, uint32_t len, int shift) {
+    int bits = 2 * shift;
+    uint8_t carry = 0xFF >> (8 - bits);
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t val = buf[i];
+        buf[i] = (val << bits) | carry;
+        carry = val >> (8 - bits);
+    }
+}
+
 __attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_8ppB(
     const uint32_t* line_data, uint8_t* epd_input, const uint8_t* lut, uint32_t epd_width
 ) {
@@ -171,7 +185,7 @@ void IRAM_ATTR calc_epd_input_1ppB_1k_S3_VE_aligned(
     const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
 );
 
-#ifdef RENDER_METHOD_I2S
+#ifndef RENDER_METHOD_LCD
 void calc_epd_input_1ppB_1k_S3_VE_aligned(
     const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
 ) {
@@ -188,8 +202,8 @@ void IRAM_ATTR calc_epd_input_1ppB_1k_S3_VE(
     const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
 ) {
     // alignment boundaries in pixels
-    int unaligned_len_front = (16 - (uint32_t)ld % 16) % 16;
-    int unaligned_len_back = ((uint32_t)ld + epd_width) % 16;
+    int unaligned_len_front = (16 - (uintptr_t)ld % 16) % 16;
+    int unaligned_len_back = ((uintptr_t)ld + epd_width) % 16;
     int aligned_len = epd_width - unaligned_len_front - unaligned_len_back;
 
     if (unaligned_len_front) {
@@ -221,6 +235,25 @@ __attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_1ppB_64k(
     }
 }
 
+/**
+ * Calculate EPD input for a difference image with one pixel per byte,
+ * using a 1K LUT with a copy shifted to the output position of each of the four pixels.
+ */
+__attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_1ppB_1k(
+    const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
+) {
+    const uint8_t* lut_0 = conversion_lut;
+    const uint8_t* lut_1 = conversion_lut + 0x100;
+    const uint8_t* lut_2 = conversion_lut + 0x200;
+    const uint8_t* lut_3 = conversion_lut + 0x300;
+
+    for (uint32_t j = 0; j < epd_width / 4; j++) {
+        uint32_t v = ld[j];
+        epd_input[j] = lut_0[v & 0xFF] | lut_1[(v >> 8) & 0xFF] | lut_2[(v >> 16) & 0xFF]
+                       | lut_3[v >> 24];
+    }
+}
+
 __attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_2ppB_lut_64k(
     const uint32_t* line_data, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
 ) {
@@ -282,6 +315,38 @@ __attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_2ppB_1k_lut_black(
     calc_epd_input_2ppB_1k_lut(ld, epd_input, conversion_lut, 0x0, epd_width);
 }
 
+/**
+ * Calculate EPD input for a 2bpp buffer with a fixed "from" value.
+ * The LUT maps four pixels of input to four pixels of output.
+ */
+__attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_4ppB_256b(
+    const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
+) {
+    const uint8_t* data = (const uint8_t*)ld;
+    for (uint32_t j = 0; j < epd_width / 4; j++) {
+        epd_input[j] = conversion_lut[data[j]];
+    }
+}
+
+/**
+ * Calculate EPD input for two interleaved 2bpp lines,
+ * with the "from" byte in the lower and the "to" byte in the upper half of each 16 bit word.
+ * The 1K LUT maps two pixels of "to" and "from" each to two pixels of output,
+ * followed by a copy shifted to the upper output nibble.
+ */
+__attribute__((optimize("O3"))) void IRAM_ATTR calc_epd_input_4ppB_1k_difference(
+    const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
+) {
+    const uint16_t* line_data_16 = (const uint16_t*)ld;
+    for (uint32_t j = 0; j < epd_width / 4; j++) {
+        uint16_t v = *(line_data_16++);
+        uint8_t to = v >> 8;
+        uint8_t from = v & 0xFF;
+        epd_input[j] = conversion_lut[((to & 0x0F) << 4) | (from & 0x0F)]
+                       | (conversion_lut + 0x100)[(to & 0xF0) | (from >> 4)];
+    }
+}
+
 ///////////////////////////// Calculate Lookup Tables
 //////////////////////////////////
 
@@ -419,6 +484,92 @@ static void build_2ppB_lut_64k_from_15(uint8_t* lut, const EpdWaveformPhases* ph
     build_2ppB_lut_64k_static_from(lut, phases, 0xF, frame);
 }
 
+/**
+ * Look up the action of a transition between two 4bpp gray levels.
+ */
+static inline uint8_t waveform_action(const uint8_t* p_lut, uint8_t to, uint8_t from) {
+    return (p_lut[(to << 2) + (from >> 2)] >> (6 - 2 * (from & 3))) & 3;
+}
+
+/**
+ * Build a LUT mapping a byte of a 2bpp buffer to the output,
+ * if the previous color is known.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR build_4ppB_lut_256b_static_from(
+    uint8_t* lut, const EpdWaveformPhases* phases, uint8_t from, int frame
+) {
+    const uint8_t* p_lut = phases->luts + (16 * 4 * frame);
+
+    uint8_t actions[4];
+    for (uint8_t v = 0; v < 4; v++) {
+        actions[v] = waveform_action(p_lut, v * 5, from);
+    }
+    for (int i = 0; i < 0x100; i++) {
+        lut[i] = actions[i & 3] | (actions[(i >> 2) & 3] << 2) | (actions[(i >> 4) & 3] << 4)
+                 | (actions[i >> 6] << 6);
+    }
+}
+
+static void build_4ppB_lut_256b_from_0(uint8_t* lut, const EpdWaveformPhases* phases, int frame) {
+    build_4ppB_lut_256b_static_from(lut, phases, 0, frame);
+}
+
+static void build_4ppB_lut_256b_from_15(uint8_t* lut, const EpdWaveformPhases* phases, int frame) {
+    build_4ppB_lut_256b_static_from(lut, phases, 0xF, frame);
+}
+
+/**
+ * Build a table of the output for two pixels, indexed by two 2bpp pixels
+ * of the "to" buffer in the upper and two of the "from" buffer in the lower nibble.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR
+build_4ppB_pair_table(uint8_t* table, const EpdWaveformPhases* phases, int frame) {
+    const uint8_t* p_lut = phases->luts + (16 * 4 * frame);
+
+    uint8_t actions[16];
+    for (uint8_t to = 0; to < 4; to++) {
+        for (uint8_t from = 0; from < 4; from++) {
+            actions[(to << 2) | from] = waveform_action(p_lut, to * 5, from * 5);
+        }
+    }
+    for (int i = 0; i < 0x100; i++) {
+        uint8_t to = i >> 4;
+        uint8_t from = i & 0xF;
+        table[i] = actions[((to & 3) << 2) | (from & 3)]
+                   | (actions[(to & 0xC) | (from >> 2)] << 2);
+    }
+}
+
+/**
+ * LUT for `calc_epd_input_4ppB_1k_difference()`.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR
+build_4ppB_difference_lut_1k(uint8_t* lut, const EpdWaveformPhases* phases, int frame) {
+    build_4ppB_pair_table(lut, phases, frame);
+    for (int i = 0; i < 0x100; i++) {
+        lut[0x100 + i] = lut[i] << 4;
+    }
+}
+
+/**
+ * LUT indexed by a byte of the "to" and a byte of the "from" 2bpp buffers,
+ * for looking up four pixels at once with `calc_epd_input_2ppB_lut_64k()`.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR
+build_4ppB_difference_lut_64k(uint8_t* lut, const EpdWaveformPhases* phases, int frame) {
+    uint8_t pairs[0x100];
+    build_4ppB_pair_table(pairs, phases, frame);
+
+    for (int to = 0; to < 0x100; to++) {
+        uint8_t* row = &lut[to << 8];
+        uint8_t low = (to & 0x0F) << 4;
+        uint8_t high = to & 0xF0;
+        for (int from = 0; from < 0x100; from++) {
+            row[from] = pairs[low | (from & 0x0F)] | (pairs[high | (from >> 4)] << 4);
+        }
+    }
+}
+
 static void build_8ppB_lut_256b_from_white(
     uint8_t* lut, const EpdWaveformPhases* phases, int frame
 ) {
@@ -441,16 +592,25 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
     LutFunctionPair pair;
     pair.build_func = NULL;
     pair.lookup_func = NULL;
+    pair.lut_size = 0;
 
     if (mode & MODE_PACKING_1PPB_DIFFERENCE) {
         if (EPD_CURRENT_RENDER_METHOD == RENDER_METHOD_LCD && !(mode & MODE_FORCE_NO_PIE)
             && lut_size >= 1024) {
             pair.build_func = &build_1ppB_lut_S3_VE_1k;
             pair.lookup_func = &calc_epd_input_1ppB_1k_S3_VE;
+            pair.lut_size = 1 << 10;
             return pair;
         } else if (lut_size >= 1 << 16) {
             pair.build_func = &build_1ppB_lut_64k;
             pair.lookup_func = &calc_epd_input_1ppB_64k;
+            pair.lut_size = 1 << 16;
+            return pair;
+        } else if (lut_size >= 1 << 10) {
+            // the shifted copies of the 1k LUT correspond to the four pixels of an input word
+            pair.build_func = &build_2ppB_lut_1k;
+            pair.lookup_func = &calc_epd_input_1ppB_1k;
+            pair.lut_size = 1 << 10;
             return pair;
         }
     } else if (mode & MODE_PACKING_2PPB) {
@@ -458,22 +618,54 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
             if (mode & PREVIOUSLY_WHITE) {
                 pair.build_func = &build_2ppB_lut_64k_from_15;
                 pair.lookup_func = &calc_epd_input_2ppB_lut_64k;
+                pair.lut_size = 1 << 16;
                 return pair;
             } else if (mode & PREVIOUSLY_BLACK) {
                 pair.build_func = &build_2ppB_lut_64k_from_0;
                 pair.lookup_func = &calc_epd_input_2ppB_lut_64k;
+                pair.lut_size = 1 << 16;
                 return pair;
             }
         } else if (lut_size >= 1024) {
             if (mode & PREVIOUSLY_WHITE) {
                 pair.build_func = &build_2ppB_lut_1k;
                 pair.lookup_func = &calc_epd_input_2ppB_1k_lut_white;
+                pair.lut_size = 1 << 10;
                 return pair;
             } else if (mode & PREVIOUSLY_BLACK) {
                 pair.build_func = &build_2ppB_lut_1k;
                 pair.lookup_func = &calc_epd_input_2ppB_1k_lut_black;
+                pair.lut_size = 1 << 10;
+                return pair;
+            }
+        }
+    } else if (mode & MODE_PACKING_4PPB) {
+        if (mode & (PREVIOUSLY_WHITE | PREVIOUSLY_BLACK)) {
+            // a single byte lookup is sufficient for any LUT size
+            if (lut_size < 1 << 8) {
                 return pair;
             }
+            if (mode & PREVIOUSLY_WHITE) {
+                pair.build_func = &build_4ppB_lut_256b_from_15;
+            } else {
+                pair.build_func = &build_4ppB_lut_256b_from_0;
+            }
+            pair.lookup_func = &calc_epd_input_4ppB_256b;
+            pair.lut_size = 1 << 8;
+            return pair;
+        }
+
+        // Difference to a previous 2bpp buffer, interleaved by the render threads.
+        if (lut_size >= 1 << 16) {
+            pair.build_func = &build_4ppB_difference_lut_64k;
+            pair.lookup_func = &calc_epd_input_2ppB_lut_64k;
+            pair.lut_size = 1 << 16;
+            return pair;
+        } else if (lut_size >= 1024) {
+            pair.build_func = &build_4ppB_difference_lut_1k;
+            pair.lookup_func = &calc_epd_input_4ppB_1k_difference;
+            pair.lut_size = 2 << 8;
+            return pair;
         }
     } else if (mode & MODE_PACKING_8PPB) {
         if (lut_size < sizeof(lut_8ppB_start_at_white)) {
@@ -483,10 +675,12 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
         if (mode & PREVIOUSLY_WHITE) {
             pair.build_func = &build_8ppB_lut_256b_from_white;
             pair.lookup_func = &calc_epd_input_8ppB;
+            pair.lut_size = sizeof(lut_8ppB_start_at_white);
             return pair;
         } else if (mode & PREVIOUSLY_BLACK) {
             pair.build_func = &build_8ppB_lut_256b_from_black;
             pair.lookup_func = &calc_epd_input_8ppB;
+            pair.lut_size = sizeof(lut_8ppB_start_at_black);
             return pair;
         }
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include "epdiy.h"
 
@@ -23,6 +24,8 @@ typedef void (*lut_build_func_t)(uint8_t* lut, const EpdWaveformPhases* phases,
 typedef struct {
     lut_build_func_t build_func;
     lut_func_t lookup_func;
+    /// Number of LUT bytes written by `build_func`.
+    size_t lut_size;
 } LutFunctionPair;
 
 /**
@@ -45,3 +48,4 @@ void epd_apply_line_mask(uint8_t* buf, const uint8_t* mask, int len);
 // legacy functions
 void bit_shift_buffer_right(uint8_t* buf, uint32_t len, int shift);
 void nibble_shift_buffer_right(uint8_t* buf, uint32_t len);
+void crumb_shift_buffer_right(uint8_t* buf, uint32_t len, int shift);
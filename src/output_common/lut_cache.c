@@ -0,0 +1,114 @@
+#include "lut_cache.h"
+
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Upper bound for the number of cached LUTs.
+/// Waveform modes rarely have more frames than this.
+#define LUT_CACHE_MAX_ENTRIES 128
+
+/// Whether `entry` holds a frame of the same mode and LUT format as `key`.
+static inline bool mode_matches(const LutCacheEntry_t* entry, const LutCacheKey_t* key) {
+    return entry->data != NULL && entry->build_func == key->build_func
+           && entry->waveform == key->waveform && entry->waveform_index == key->waveform_index
+           && entry->waveform_range == key->waveform_range;
+}
+
+static inline bool key_matches(const LutCacheEntry_t* entry, const LutCacheKey_t* key) {
+    return mode_matches(entry, key) && entry->frame == key->frame;
+}
+
+bool lut_cache_init(LutCache_t* cache, size_t entry_size, size_t budget) {
+    int num_entries = budget / entry_size;
+    if (num_entries > LUT_CACHE_MAX_ENTRIES) {
+        num_entries = LUT_CACHE_MAX_ENTRIES;
+    }
+    if (num_entries < 1) {
+        num_entries = 1;
+    }
+
+    cache->entries = calloc(num_entries, sizeof(LutCacheEntry_t));
+    if (cache->entries == NULL) {
+        return false;
+    }
+    cache->num_entries = num_entries;
+    cache->entry_size = entry_size;
+    cache->use_counter = 0;
+    return true;
+}
+
+void lut_cache_free(LutCache_t* cache) {
+    if (cache->entries == NULL) {
+        return;
+    }
+    for (int i = 0; i < cache->num_entries; i++) {
+        heap_caps_free(cache->entries[i].data);
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->num_entries = 0;
+}
+
+bool IRAM_ATTR lut_cache_fetch(LutCache_t* cache, const LutCacheKey_t* key, uint8_t* lut) {
+    for (int i = 0; i < cache->num_entries; i++) {
+        LutCacheEntry_t* entry = &cache->entries[i];
+        if (key_matches(entry, key)) {
+            entry->last_used = ++cache->use_counter;
+            memcpy(lut, entry->data, entry->size);
+            return true;
+        }
+    }
+    return false;
+}
+
+void IRAM_ATTR
+lut_cache_store(LutCache_t* cache, const LutCacheKey_t* key, const uint8_t* lut, size_t size) {
+    if (size > cache->entry_size) {
+        return;
+    }
+
+    // Prefer empty entries, then the least recently used one of another mode.
+    // Frames of the same mode are never evicted: updates use the frames in order,
+    // so with more frames than entries, LRU eviction would drop every frame
+    // before its next use. Instead, the first frames of the mode stay cached.
+    LutCacheEntry_t* victim = NULL;
+    for (int i = 0; i < cache->num_entries; i++) {
+        LutCacheEntry_t* entry = &cache->entries[i];
+        if (entry->data == NULL) {
+            victim = entry;
+            break;
+        }
+        if (mode_matches(entry, key)) {
+            continue;
+        }
+        if (victim == NULL || entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+    if (victim == NULL) {
+        return;
+    }
+
+    if (victim->data == NULL) {
+        victim->data = heap_caps_malloc(cache->entry_size, MALLOC_CAP_SPIRAM);
+        if (victim->data == NULL) {
+            victim->data = heap_caps_malloc(cache->entry_size, MALLOC_CAP_8BIT);
+        }
+        if (victim->data == NULL) {
+            ESP_LOGW("epdiy", "could not allocate LUT cache entry");
+            return;
+        }
+    }
+
+    victim->build_func = key->build_func;
+    victim->waveform = key->waveform;
+    victim->waveform_index = key->waveform_index;
+    victim->waveform_range = key->waveform_range;
+    victim->frame = key->frame;
+    victim->size = size;
+    victim->last_used = ++cache->use_counter;
+    memcpy(victim->data, lut, size);
+}
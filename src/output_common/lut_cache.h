@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lut.h"
+
+/// A cached lookup table for a frame of a waveform mode.
+typedef struct {
+    /// The LUT building function, which determines the LUT format.
+    lut_build_func_t build_func;
+    const EpdWaveform* waveform;
+    int waveform_index;
+    int waveform_range;
+    int frame;
+    /// Number of valid bytes in `data`.
+    size_t size;
+    /// Value of the cache use counter at the last access, for LRU eviction.
+    uint32_t last_used;
+    uint8_t* data;
+} LutCacheEntry_t;
+
+/// A cache of built lookup tables.
+/// Entries of other modes are evicted least-recently-used first,
+/// while the frames of a mode which does not fit into the cache
+/// keep the frames stored first.
+typedef struct {
+    LutCacheEntry_t* entries;
+    int num_entries;
+    /// Capacity of each entry in bytes.
+    size_t entry_size;
+    uint32_t use_counter;
+} LutCache_t;
+
+/// Key of a lookup table in the cache.
+typedef struct {
+    lut_build_func_t build_func;
+    const EpdWaveform* waveform;
+    int waveform_index;
+    int waveform_range;
+    int frame;
+} LutCacheKey_t;
+
+/// Initialize the LUT cache for LUTs of up to `entry_size` bytes,
+/// using at most `budget` bytes of PSRAM or, if unavailable, general purpose memory.
+/// Entry memory is allocated on first use.
+/// Returns `false` if the cache could not be allocated.
+bool lut_cache_init(LutCache_t* cache, size_t entry_size, size_t budget);
+
+/// Free the cache and its entries.
+void lut_cache_free(LutCache_t* cache);
+
+/// Copy the cached LUT for `key` to `lut`.
+/// Returns `false` if there is no such entry.
+bool lut_cache_fetch(LutCache_t* cache, const LutCacheKey_t* key, uint8_t* lut);
+
+/// Store `size` bytes of the LUT built for `key`, evicting the least recently used entry
+/// of another mode. If all entries hold frames of the same mode, the LUT is not stored.
+void lut_cache_store(LutCache_t* cache, const LutCacheKey_t* key, const uint8_t* lut, size_t size);
@@ -1,11 +1,14 @@
 #include "render_context.h"
 
+#include <esp_timer.h>
+#include <limits.h>
 #include <string.h>
 #include "esp_log.h"
 
 #include "../epdiy.h"
 #include "lut.h"
 #include "render_method.h"
+#include "trace.h"
 
 /// For waveforms without timing and the I2S diving method,
 /// the default hold time for each line is 12us
@@ -39,6 +42,9 @@ void get_buffer_params(
     } else if (mode & MODE_PACKING_2PPB) {
         *bytes_per_line = area.width / 2 + area.width % 2;
         width_divider = 2;
+    } else if (mode & MODE_PACKING_4PPB) {
+        *bytes_per_line = area.width / 4 + (area.width % 4 > 0);
+        width_divider = 4;
     } else if (mode & MODE_PACKING_8PPB) {
         *bytes_per_line = (area.width / 8 + (area.width % 8 > 0));
         width_divider = 8;
@@ -68,6 +74,72 @@ void get_buffer_params(
     *pixels_per_byte = width_divider;
 }
 
+/**
+ * Build the LUT for `frame` of the current update cycle into `lut`, traced on `track`.
+ * Returns whether the LUT was taken from the LUT cache.
+ */
+static bool IRAM_ATTR build_frame_lut(RenderContext_t* ctx, uint8_t* lut, int frame, int track) {
+    const EpdWaveformPhases* phases
+        = ctx->waveform->mode_data[ctx->waveform_index]->range_data[ctx->waveform_range];
+
+    assert(ctx->lut_build_func != NULL);
+    int64_t start_us = esp_timer_get_time();
+    uint32_t trace_start = epd_trace_begin();
+    bool cached = false;
+    if (ctx->lut_cache != NULL) {
+        LutCacheKey_t key = {
+            .build_func = ctx->lut_build_func,
+            .waveform = ctx->waveform,
+            .waveform_index = ctx->waveform_index,
+            .waveform_range = ctx->waveform_range,
+            .frame = frame,
+        };
+        cached = lut_cache_fetch(ctx->lut_cache, &key, lut);
+        if (!cached) {
+            ctx->lut_build_func(lut, phases, frame);
+            lut_cache_store(ctx->lut_cache, &key, lut, ctx->lut_build_size);
+        }
+    } else {
+        ctx->lut_build_func(lut, phases, frame);
+    }
+
+    EpdFrameStats* stats = epd_frame_stats(ctx, frame);
+    if (stats != NULL) {
+        stats->lut_build_us = esp_timer_get_time() - start_us;
+    }
+    epd_trace_end(EPD_TRACE_LUT_BUILD, track, frame, trace_start);
+    return cached;
+}
+
+/// Count a LUT cache lookup, on the update task only.
+static void count_lut_cache_lookup(RenderContext_t* ctx, bool cached) {
+    if (ctx->lut_cache == NULL) {
+        return;
+    }
+    if (cached) {
+        ctx->stats.lut_cache_hits++;
+    } else {
+        ctx->stats.lut_cache_misses++;
+    }
+}
+
+void IRAM_ATTR epd_build_next_lut(RenderContext_t* ctx, int thread_id) {
+    if (ctx->next_conversion_lut == NULL || atomic_exchange(&ctx->next_lut_claimed, true)) {
+        return;
+    }
+
+    int frame = ctx->current_frame + 1;
+    while (frame < ctx->cycle_frames && !epd_frame_is_active(ctx, frame)) {
+        frame++;
+    }
+    if (frame >= ctx->cycle_frames) {
+        return;
+    }
+
+    ctx->next_lut_cached = build_frame_lut(ctx, ctx->next_conversion_lut, frame, thread_id);
+    ctx->next_lut_frame = frame;
+}
+
 void IRAM_ATTR prepare_context_for_next_frame(RenderContext_t* ctx) {
     int frame_time = DEFAULT_FRAME_TIME;
     if (ctx->phase_times != NULL) {
@@ -79,14 +151,183 @@ void IRAM_ATTR prepare_context_for_next_frame(RenderContext_t* ctx) {
     }
     ctx->frame_time = frame_time;
 
-    const EpdWaveformPhases* phases
-        = ctx->waveform->mode_data[ctx->waveform_index]->range_data[ctx->waveform_range];
+    // the LUT may already have been built by a feed thread during the last frame
+    if (ctx->next_lut_frame == ctx->current_frame) {
+        uint8_t* lut = ctx->conversion_lut;
+        ctx->conversion_lut = ctx->next_conversion_lut;
+        ctx->next_conversion_lut = lut;
+        count_lut_cache_lookup(ctx, ctx->next_lut_cached);
+    } else {
+        bool cached = build_frame_lut(
+            ctx, ctx->conversion_lut, ctx->current_frame, EPD_TRACE_TRACK_UPDATE
+        );
+        count_lut_cache_lookup(ctx, cached);
+    }
+    ctx->next_lut_frame = -1;
+    atomic_store(&ctx->next_lut_claimed, false);
 
-    assert(ctx->lut_build_func != NULL);
-    ctx->lut_build_func(ctx->conversion_lut, phases, ctx->current_frame);
+    ctx->lines_prepared = ctx->lines_first;
+    ctx->lines_consumed = ctx->lines_first;
+    for (int i = 0; i < MAX_RENDER_THREADS; i++) {
+        atomic_store(&ctx->feed_lines[i], 0);
+        ctx->feed_chunk_start[i] = 0;
+    }
+}
+
+void epd_stats_begin(RenderContext_t* ctx) {
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    ctx->stats.workers = ctx->num_feed_tasks;
+    ctx->stats.queue_capacity = ctx->line_queues[0].size - 1;
+    ctx->stats.queue_min = INT_MAX;
+    ctx->queue_fill_sum = 0;
+}
+
+void epd_stats_end(RenderContext_t* ctx) {
+    EpdRenderStats* stats = &ctx->stats;
+    if (stats->lines_output > 0) {
+        stats->queue_avg = (float)ctx->queue_fill_sum / stats->lines_output;
+    } else {
+        stats->queue_min = 0;
+    }
+}
+
+void epd_stats_frame_done(RenderContext_t* ctx, int64_t start_us) {
+    ctx->stats.frames++;
+    EpdFrameStats* stats = epd_frame_stats(ctx, ctx->current_frame);
+    if (stats != NULL) {
+        stats->frame_us = esp_timer_get_time() - start_us;
+    }
+}
+
+void epd_start_feed_tasks(RenderContext_t* ctx) {
+    BaseType_t core = xPortGetCoreID();
+    for (int i = 0; i < ctx->num_feed_tasks; i++) {
+        if (ctx->feed_task_cores[i] != core) {
+            xTaskNotifyGive(ctx->feed_tasks[i]);
+        }
+    }
+    for (int i = 0; i < ctx->num_feed_tasks; i++) {
+        if (ctx->feed_task_cores[i] == core) {
+            xTaskNotifyGive(ctx->feed_tasks[i]);
+        }
+    }
+}
+
+#define FEED_LINES(next, end) ((unsigned)(next) | ((unsigned)(end) << 16))
+#define FEED_LINES_NEXT(lines) ((int)((lines) & 0xFFFF))
+#define FEED_LINES_END(lines) ((int)((lines) >> 16))
+
+/// Steal the upper half of the lines claimed by another feed task.
+/// Only lines from `min_line` on can be taken, to keep the lines of a task increasing.
+static int IRAM_ATTR steal_feed_lines(RenderContext_t* ctx, int thread_id, int min_line) {
+    for (int i = 1; i < ctx->num_feed_tasks; i++) {
+        int victim = (thread_id + i) % ctx->num_feed_tasks;
+        unsigned lines = atomic_load(&ctx->feed_lines[victim]);
+        while (true) {
+            int next = FEED_LINES_NEXT(lines);
+            int end = FEED_LINES_END(lines);
+            int split = next + (end - next + 1) / 2;
+            if (split >= end || split < min_line) {
+                break;
+            }
+            if (atomic_compare_exchange_weak(
+                    &ctx->feed_lines[victim], &lines, FEED_LINES(next, split)
+                )) {
+                atomic_store(&ctx->feed_lines[thread_id], FEED_LINES(split + 1, end));
+                ctx->feed_chunk_start[thread_id] = epd_trace_begin();
+                ctx->feed_chunk_line[thread_id] = split;
+                return split;
+            }
+        }
+    }
+    return -1;
+}
+
+int IRAM_ATTR epd_next_feed_line(RenderContext_t* ctx, int thread_id) {
+    atomic_uint* own = &ctx->feed_lines[thread_id];
+
+    // other tasks may concurrently steal from the end
+    unsigned lines = atomic_load(own);
+    while (FEED_LINES_NEXT(lines) < FEED_LINES_END(lines)) {
+        if (atomic_compare_exchange_weak(own, &lines, lines + 1)) {
+            return FEED_LINES_NEXT(lines);
+        }
+    }
+
+    // the current chunk is done
+    epd_trace_end(
+        EPD_TRACE_FEED_CHUNK,
+        thread_id,
+        ctx->feed_chunk_line[thread_id],
+        ctx->feed_chunk_start[thread_id]
+    );
+    ctx->feed_chunk_start[thread_id] = 0;
+
+    int start = atomic_fetch_add(&ctx->lines_prepared, ctx->line_chunk);
+    if (start < ctx->lines_total) {
+        int end = min(start + ctx->line_chunk, ctx->lines_total);
+        atomic_store(own, FEED_LINES(start + 1, end));
+        ctx->feed_chunk_start[thread_id] = epd_trace_begin();
+        ctx->feed_chunk_line[thread_id] = start;
+        return start;
+    }
+
+    return steal_feed_lines(ctx, thread_id, FEED_LINES_NEXT(lines));
+}
+
+uint8_t* IRAM_ATTR epd_wait_for_queue_space(RenderContext_t* ctx, int thread_id) {
+    LineQueue_t* lq = &ctx->line_queues[thread_id];
+    uint8_t* buf;
+    while ((buf = lq_current(lq)) == NULL) {
+        atomic_store(&ctx->feed_waiting[thread_id], true);
+
+        // the consumer may have freed space or failed before seeing the flag
+        if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
+            atomic_store(&ctx->feed_waiting[thread_id], false);
+            return NULL;
+        }
+        if (lq_free_slots(lq) >= epd_feed_wake_slots(lq)) {
+            atomic_store(&ctx->feed_waiting[thread_id], false);
+            continue;
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        uint32_t trace_start = epd_trace_begin();
+        xSemaphoreTake(ctx->queue_space_smphr[thread_id], portMAX_DELAY);
+        ctx->stats.feed_wait_us[thread_id] += esp_timer_get_time() - start_us;
+        epd_trace_end(EPD_TRACE_QUEUE_WAIT, thread_id, ctx->lines_consumed, trace_start);
+    }
+    return buf;
+}
 
-    ctx->lines_prepared = 0;
-    ctx->lines_consumed = 0;
+/**
+ * Interleave the bytes of two 2bpp lines to 16 bit words,
+ * with the byte of `from` in the lower half.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR
+interleave_line_2bpp(const uint8_t* to, const uint8_t* from, uint16_t* interleaved, int len) {
+    for (int i = 0; i < len; i++) {
+        interleaved[i] = (to[i] << 8) | from[i];
+    }
+}
+
+const uint32_t* IRAM_ATTR epd_interlace_feed_line(
+    RenderContext_t* ctx, int thread_id, const uint8_t* to, const uint8_t* from
+) {
+    if (ctx->mode & MODE_PACKING_4PPB) {
+        uint16_t* interleaved = (uint16_t*)ctx->feed_line_buffers[thread_id];
+        interleave_line_2bpp(to, from, interleaved, ctx->display_width / 4);
+        return (const uint32_t*)interleaved;
+    }
+
+    // Match the alignment of the output and dirtyness buffers to the input line,
+    // so the vectorized interlacing can be used on the aligned part.
+    uint32_t misalignment = (uintptr_t)to % 16;
+    uint8_t* interlaced = ctx->feed_line_buffers[thread_id] + (2 * misalignment) % 16;
+    uint8_t* col_dirtyness = ctx->feed_col_dirtyness[thread_id] + misalignment;
+
+    _epd_interlace_line(to, from, interlaced, col_dirtyness, ctx->display_width);
+    return (const uint32_t*)interlaced;
 }
 
 void epd_populate_line_mask(uint8_t* line_mask, const uint8_t* dirty_columns, int mask_len) {
@@ -103,4 +344,51 @@ void epd_populate_line_mask(uint8_t* line_mask, const uint8_t* dirty_columns, in
             line_mask[c / 2] = mask;
         }
     }
-}
\ No newline at end of file
+}
+
+void epd_find_column_span(const uint8_t* dirty_columns, int width, int* span_x, int* span_width) {
+    if (dirty_columns == NULL) {
+        *span_x = 0;
+        *span_width = width;
+        return;
+    }
+
+    // two columns per byte
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < width / 2; i++) {
+        if (dirty_columns[i]) {
+            first = first < 0 ? i : first;
+            last = i;
+        }
+    }
+    if (first < 0) {
+        *span_x = 0;
+        *span_width = 0;
+        return;
+    }
+
+    int start = first * 2 / COLUMN_SPAN_ALIGN * COLUMN_SPAN_ALIGN;
+    int end = (last * 2 + 2 + COLUMN_SPAN_ALIGN - 1) / COLUMN_SPAN_ALIGN * COLUMN_SPAN_ALIGN;
+    *span_x = start;
+    *span_width = min(end, width) - start;
+}
+
+void IRAM_ATTR epd_lookup_line(RenderContext_t* ctx, const uint32_t* lp, uint8_t* buf) {
+    if (ctx->span_width == ctx->display_width) {
+        ctx->lut_lookup_func(lp, buf, ctx->conversion_lut, ctx->display_width);
+        return;
+    }
+
+    int line_bytes = ctx->display_width / 4;
+    int span_start = ctx->span_x / 4;
+    int span_end = span_start + ctx->span_width / 4;
+    memset(buf, 0x00, span_start);
+    if (ctx->span_width > 0) {
+        const uint8_t* input = (const uint8_t*)lp + ctx->span_input_offset;
+        ctx->lut_lookup_func(
+            (const uint32_t*)input, buf + span_start, ctx->conversion_lut, ctx->span_width
+        );
+    }
+    memset(buf + span_end, 0x00, line_bytes - span_end);
+}
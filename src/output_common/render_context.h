@@ -9,35 +9,81 @@
 #include "../epdiy.h"
 #include "line_queue.h"
 #include "lut.h"
+#include "lut_cache.h"
 
-#define NUM_RENDER_THREADS 2
+/// Maximum number of render tasks, see `EPD_RENDER_WORKERS()`.
+#define MAX_RENDER_THREADS EPD_MAX_RENDER_WORKERS
+
+/// Marks lines in `line_threads` which are not yet taken by a feed task.
+#define LINE_NOT_TAKEN 0xFF
+
+/// Maximum number of waveform frames for which inactive frames can be skipped.
+#define MAX_ACTIVE_FRAMES 256
+
+/// Time to skip a line above the drawn lines with a gate-only clock pulse, in 1/10us.
+/// This is the period of the skip pulses of the LCD driver.
+#define SKIP_LINE_TIME 50
+
+/// Alignment of the dirty column span in pixels.
+/// Keeps the span in output lines aligned to 16 bytes for the vector extensions.
+#define COLUMN_SPAN_ALIGN 64
 
 typedef struct {
     EpdRect area;
     EpdRect crop_to;
     const bool* drawn_lines;
     const uint8_t* data_ptr;
+    /// Previous 4bpp framebuffer when calculating the difference on the fly, NULL otherwise.
+    const uint8_t* from_ptr;
 
     /// The display width for quick access.
     int display_width;
     /// The display height for quick access.
     int display_height;
 
-    /// index of the next line of data to process
+    /// index of the first line not yet claimed by a feed task
     atomic_int lines_prepared;
+    /// Number of lines feed tasks claim from `lines_prepared` at once.
+    int line_chunk;
+    /// Lines claimed by each feed task, not yet prepared.
+    /// Packed as `next | end << 16`, idle tasks steal lines from the end.
+    atomic_uint feed_lines[MAX_RENDER_THREADS];
+    /// Trace start of the chunk of lines each feed task is working on, 0 if none.
+    uint32_t feed_chunk_start[MAX_RENDER_THREADS];
+    /// First line of the chunk each feed task is working on, for tracing.
+    int feed_chunk_line[MAX_RENDER_THREADS];
     volatile int lines_consumed;
     int lines_total;
+    /// First line output in the current frame. The lines above it are skipped
+    /// with gate-only clock pulses, see `epd_lcd_set_frame_lines()`.
+    int lines_first;
+    /// First drawn line, rounded down to a multiple of 8. The LCD and host outputs
+    /// start all but the first frame of an update at this line.
+    int lines_skippable;
 
     /// frame currently in the current update cycle
     int current_frame;
     /// number of frames in the current update cycle
     int cycle_frames;
+    /// Bit set of the frames that drive any pixel in the current update cycle.
+    /// Other frames are skipped.
+    uint32_t active_frames[MAX_ACTIVE_FRAMES / 32];
 
-    TaskHandle_t feed_tasks[NUM_RENDER_THREADS];
-    SemaphoreHandle_t feed_done_smphr[NUM_RENDER_THREADS];
+    /// Number of render tasks in use.
+    int num_feed_tasks;
+    TaskHandle_t feed_tasks[MAX_RENDER_THREADS];
+    /// Core each render task is pinned to, or `tskNO_AFFINITY`.
+    BaseType_t feed_task_cores[MAX_RENDER_THREADS];
+    SemaphoreHandle_t feed_done_smphr[MAX_RENDER_THREADS];
+    /// Given by the consumer when space frees up in the line queue of a waiting feed task.
+    SemaphoreHandle_t queue_space_smphr[MAX_RENDER_THREADS];
+    /// Set by feed tasks that sleep until their line queue has space again.
+    atomic_bool feed_waiting[MAX_RENDER_THREADS];
     SemaphoreHandle_t frame_done;
     /// Line buffers for feed tasks
-    uint8_t* feed_line_buffers[NUM_RENDER_THREADS];
+    uint8_t* feed_line_buffers[MAX_RENDER_THREADS];
+    /// Column dirtyness scratch space for feed tasks interlacing on the fly
+    uint8_t* feed_col_dirtyness[MAX_RENDER_THREADS];
 
     /// index of the waveform mode when using vendor waveforms.
     /// This is not necessarily the mode number if the waveform header
@@ -58,27 +104,120 @@ typedef struct {
     size_t conversion_lut_size;
     // Lookup table space.
     uint8_t* conversion_lut;
+    /// Second lookup table of `conversion_lut_size` bytes, into which the LUT of the
+    /// next frame is built while the current frame is output. NULL if disabled.
+    uint8_t* next_conversion_lut;
+    /// Frame the LUT in `next_conversion_lut` was built for, -1 if none.
+    int next_lut_frame;
+    /// Whether the LUT in `next_conversion_lut` was taken from the LUT cache.
+    bool next_lut_cached;
+    /// Set by the feed thread that builds the next LUT.
+    atomic_bool next_lut_claimed;
 
     /// LUT lookup function. Must not be NULL.
     lut_func_t lut_lookup_func;
     /// LUT building function. Must not be NULL
     lut_build_func_t lut_build_func;
+    /// Number of LUT bytes written by `lut_build_func`.
+    size_t lut_build_size;
+    /// Cache of built LUTs, NULL if disabled.
+    LutCache_t* lut_cache;
 
     /// Queue of lines prepared for output to the display,
     /// one for each thread.
-    LineQueue_t line_queues[NUM_RENDER_THREADS];
+    LineQueue_t line_queues[MAX_RENDER_THREADS];
     uint8_t* line_threads;
+    /// Number of frames after which each line of the current update is finished.
+    /// Finished lines are output as no-op lines.
+    uint8_t* line_frames;
 
     // Output line mask
     uint8_t* line_mask;
+    /// First column of the span of dirty columns, see `epd_find_column_span()`.
+    int span_x;
+    /// Width of the span of dirty columns. Lines are only looked up in this span.
+    int span_width;
+    /// Byte offset of `span_x` in the input lines of `lut_lookup_func`.
+    int span_input_offset;
 
     /// track line skipping when working in old i2s mode
     int skipping;
 
     /// line buffer when using epd_push_pixels
     uint8_t* static_line_buffer;
+
+    /// Statistics of the current update.
+    EpdRenderStats stats;
+    /// Sum of the queue occupancy of all output lines, for `stats.queue_avg`.
+    uint64_t queue_fill_sum;
 } RenderContext_t;
 
+/// Whether `frame` of the current update cycle drives any pixel.
+static inline bool epd_frame_is_active(const RenderContext_t* ctx, int frame) {
+    return frame >= MAX_ACTIVE_FRAMES || ((ctx->active_frames[frame / 32] >> (frame % 32)) & 1);
+}
+
+/// Whether line `line` is not drawn in the current frame.
+static inline bool epd_line_is_skipped(const RenderContext_t* ctx, int line) {
+    return (ctx->drawn_lines != NULL && !ctx->drawn_lines[line - ctx->area.y])
+           || ctx->current_frame >= ctx->line_frames[line];
+}
+
+/// Number of free line queue slots at which a waiting feed task is woken.
+/// Waking up in batches avoids a context switch for every consumed line.
+static inline int epd_feed_wake_slots(const LineQueue_t* lq) {
+    return lq->size / 4 > 0 ? lq->size / 4 : 1;
+}
+
+/**
+ * Called by the consumer after releasing lines from the queue of `thread_id`.
+ *
+ * @returns true if the feed task is waiting and enough space is free.
+ *      The consumer must then give `queue_space_smphr[thread_id]`.
+ */
+static inline bool epd_feed_needs_wake(RenderContext_t* ctx, int thread_id) {
+    LineQueue_t* lq = &ctx->line_queues[thread_id];
+    return atomic_load(&ctx->feed_waiting[thread_id])
+           && lq_free_slots(lq) >= epd_feed_wake_slots(lq)
+           && atomic_exchange(&ctx->feed_waiting[thread_id], false);
+}
+
+/**
+ * Record the output of the current line from `lq` in the statistics.
+ * Must be called before the line is released.
+ *
+ * @param underrun: Whether the line was not prepared in time.
+ */
+static inline void epd_stats_output_line(RenderContext_t* ctx, LineQueue_t* lq, bool underrun) {
+    EpdRenderStats* stats = &ctx->stats;
+    int queued = underrun ? 0 : lq->size - 1 - lq_free_slots(lq);
+    if (queued < stats->queue_min) {
+        stats->queue_min = queued;
+    }
+    ctx->queue_fill_sum += queued;
+    stats->lines_output++;
+
+    if (underrun) {
+        if (stats->underruns < EPD_STATS_MAX_UNDERRUNS) {
+            EpdUnderrun* u = &stats->underrun[stats->underruns];
+            u->frame = ctx->current_frame;
+            u->line = ctx->lines_consumed;
+        }
+        stats->underruns++;
+    }
+}
+
+/// Add the numbers of lines a feed task looked up or skipped to the statistics.
+static inline void epd_stats_feed_lines(RenderContext_t* ctx, int driven, int skipped) {
+    __atomic_fetch_add(&ctx->stats.lines_driven, driven, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ctx->stats.lines_skipped, skipped, __ATOMIC_RELAXED);
+}
+
+/// Statistics of waveform frame `frame`, NULL if it is not recorded.
+static inline EpdFrameStats* epd_frame_stats(RenderContext_t* ctx, int frame) {
+    return frame < EPD_STATS_MAX_FRAMES ? &ctx->stats.frame[frame] : NULL;
+}
+
 /**
  * Based on the render context, assign the bytes per line,
  * framebuffer start pointer, min and max vertical positions and the pixels per byte.
@@ -92,6 +231,15 @@ void get_buffer_params(
     int* pixels_per_byte
 );
 
+/// Reset the statistics for a new update.
+void epd_stats_begin(RenderContext_t* ctx);
+
+/// Finish the statistics of an update.
+void epd_stats_end(RenderContext_t* ctx);
+
+/// Record the output time of the current frame, which was started at `start_us`.
+void epd_stats_frame_done(RenderContext_t* ctx, int64_t start_us);
+
 /**
  * Prepare the render context for drawing the next frame.
  *
@@ -99,6 +247,42 @@ void get_buffer_params(
  */
 void prepare_context_for_next_frame(RenderContext_t* ctx);
 
+/**
+ * Start the render tasks for the current frame.
+ * Tasks on other cores are started first, so they are not delayed by the
+ * tasks preempting the caller.
+ */
+void epd_start_feed_tasks(RenderContext_t* ctx);
+
+/**
+ * Take the next line of the current frame to prepare in the feed task `thread_id`.
+ *
+ * Lines are claimed in chunks of `line_chunk` lines. When no chunks are left,
+ * the task steals the remaining lines of other tasks from the end.
+ * The lines a task takes are always increasing, as its line queue is consumed in order.
+ *
+ * @returns The line index, or -1 if no lines are left for this task.
+ */
+int epd_next_feed_line(RenderContext_t* ctx, int thread_id);
+
+/**
+ * Get space for the next line in the line queue of the feed task `thread_id`.
+ *
+ * If the queue is full, the task sleeps until the consumer has freed some space,
+ * instead of keeping the core busy.
+ *
+ * @returns NULL if the frame was aborted with `EPD_DRAW_EMPTY_LINE_QUEUE`.
+ */
+uint8_t* epd_wait_for_queue_space(RenderContext_t* ctx, int thread_id);
+
+/**
+ * Build the LUT of the next active frame into `next_conversion_lut`.
+ *
+ * Called by feed thread `thread_id` when it is done with the lines of the current frame.
+ * Only the first thread to call this builds the LUT, later calls return immediately.
+ */
+void epd_build_next_lut(RenderContext_t* ctx, int thread_id);
+
 /**
  * Populate an output line mask from line dirtyness with two bits per pixel.
  * If the dirtyness data is NULL, set the mask to neutral.
@@ -107,4 +291,43 @@ void prepare_context_for_next_frame(RenderContext_t* ctx);
  */
 void __attribute__((noinline)) epd_populate_line_mask(
     uint8_t* line_mask, const uint8_t* dirty_columns, int mask_len
-);
\ No newline at end of file
+);
+
+/**
+ * Find the span of columns containing all dirty columns,
+ * aligned to `COLUMN_SPAN_ALIGN` pixels and limited to `width`.
+ * If the dirtyness data is NULL, the span covers the whole width.
+ * If no column is dirty, the span is empty.
+ */
+void __attribute__((noinline)) epd_find_column_span(
+    const uint8_t* dirty_columns, int width, int* span_x, int* span_width
+);
+
+/**
+ * Look up the output of the input line `lp` into `buf` with `lut_lookup_func`.
+ * Only the dirty column span is looked up, the rest of the line is set to no-op.
+ */
+void epd_lookup_line(RenderContext_t* ctx, const uint32_t* lp, uint8_t* buf);
+
+/**
+ * Interlaces the 4bpp lines at `to`, `from` into `interlaced`, see `epd_difference_image()`.
+ * Implemented in render.c.
+ */
+bool _epd_interlace_line(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+);
+
+/**
+ * Interlace a line of the target and previous framebuffers for on-the-fly
+ * differences into the feed line buffer of `thread_id`.
+ *
+ * @returns The interlaced line in `MODE_PACKING_1PPB_DIFFERENCE` format,
+ *      or interleaved bytes of both 2bpp lines with `MODE_PACKING_4PPB`.
+ */
+const uint32_t* epd_interlace_feed_line(
+    RenderContext_t* ctx, int thread_id, const uint8_t* to, const uint8_t* from
+);
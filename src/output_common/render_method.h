@@ -10,6 +10,8 @@ enum EpdRenderMethod {
     RENDER_METHOD_I2S = 1,
     /// Use the CAM/LCD peripheral in ESP32-S3 chips.
     RENDER_METHOD_LCD = 2,
+    /// Render to memory with POSIX threads on a development host.
+    RENDER_METHOD_HOST = 3,
 };
 
 extern const enum EpdRenderMethod EPD_CURRENT_RENDER_METHOD;
@@ -18,6 +20,8 @@ extern const enum EpdRenderMethod EPD_CURRENT_RENDER_METHOD;
 #define RENDER_METHOD_I2S 1
 #elif defined(CONFIG_IDF_TARGET_ESP32S3)
 #define RENDER_METHOD_LCD 1
+#elif defined(CONFIG_IDF_TARGET_LINUX)
+#define RENDER_METHOD_HOST 1
 #else
 #error "unknown chip, cannot choose render method!"
 #endif
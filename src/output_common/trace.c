@@ -0,0 +1,150 @@
+#include "trace.h"
+
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+/// A recorded event, instants have a duration of `INSTANT`.
+typedef struct {
+    uint32_t start;
+    uint32_t duration;
+    uint16_t arg;
+    uint8_t event;
+    uint8_t track;
+    uint8_t core;
+} TraceRecord_t;
+
+#define INSTANT UINT32_MAX
+
+volatile bool epd_trace_enabled = false;
+
+static TraceRecord_t* records = NULL;
+static int capacity = 0;
+/// Number of events recorded since the start, the ring buffer holds the last `capacity`.
+static atomic_uint recorded = 0;
+/// Time of `epd_trace_start()`, minus one so trace times are never 0.
+static int64_t time_base = 0;
+
+static const struct {
+    const char* name;
+    const char* arg_name;
+} event_info[EPD_TRACE_EVENT_COUNT] = {
+    [EPD_TRACE_UPDATE] = { "update", "frames" },
+    [EPD_TRACE_DIFF] = { "difference image", "lines" },
+    [EPD_TRACE_BUFFER_SYNC] = { "back buffer sync", "lines" },
+    [EPD_TRACE_FRAME] = { "frame", "frame" },
+    [EPD_TRACE_FRAME_DONE] = { "frame done", "frame" },
+    [EPD_TRACE_LUT_BUILD] = { "LUT build", "frame" },
+    [EPD_TRACE_FEED_FRAME] = { "prepare frame", "frame" },
+    [EPD_TRACE_FEED_CHUNK] = { "line chunk", "line" },
+    [EPD_TRACE_QUEUE_WAIT] = { "wait for queue", "lines_consumed" },
+    [EPD_TRACE_LINE_OUTPUT] = { "line output", "line" },
+};
+
+uint32_t IRAM_ATTR epd_trace_time() {
+    return esp_timer_get_time() - time_base;
+}
+
+void IRAM_ATTR epd_trace_record(enum EpdTraceEvent event, int track, int arg, uint32_t start) {
+    uint32_t now = epd_trace_time();
+    unsigned index = atomic_fetch_add(&recorded, 1) % capacity;
+    TraceRecord_t* record = &records[index];
+    record->start = start != 0 ? start : now;
+    record->duration = start != 0 ? now - start : INSTANT;
+    record->arg = arg;
+    record->event = event;
+    record->track = track;
+    record->core = xPortGetCoreID();
+}
+
+bool epd_trace_start(int num_events) {
+    epd_trace_enabled = false;
+    epd_trace_free();
+
+    records = heap_caps_malloc(num_events * sizeof(TraceRecord_t), MALLOC_CAP_INTERNAL);
+    if (records == NULL) {
+        return false;
+    }
+    capacity = num_events;
+    atomic_store(&recorded, 0);
+    time_base = esp_timer_get_time() - 1;
+    epd_trace_enabled = true;
+    return true;
+}
+
+void epd_trace_stop() {
+    epd_trace_enabled = false;
+}
+
+void epd_trace_free() {
+    epd_trace_enabled = false;
+    heap_caps_free(records);
+    records = NULL;
+    capacity = 0;
+    atomic_store(&recorded, 0);
+}
+
+int epd_trace_event_count() {
+    unsigned count = atomic_load(&recorded);
+    return count < capacity ? count : capacity;
+}
+
+static void write_track_name(FILE* out, int core, int track) {
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,", core, track);
+    if (track == EPD_TRACE_TRACK_UPDATE) {
+        fprintf(out, "\"args\":{\"name\":\"update\"}},\n");
+    } else if (track == EPD_TRACE_TRACK_ISR) {
+        fprintf(out, "\"args\":{\"name\":\"line ISR\"}},\n");
+    } else {
+        fprintf(out, "\"args\":{\"name\":\"render worker %d\"}},\n", track);
+    }
+}
+
+void epd_trace_write_json(FILE* out) {
+    int count = epd_trace_event_count();
+    unsigned first = atomic_load(&recorded) - count;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    // name the cores and the tracks on them
+    uint32_t named[portNUM_PROCESSORS] = { 0 };
+    for (int i = 0; i < count; i++) {
+        const TraceRecord_t* r = &records[(first + i) % capacity];
+        if (r->core < portNUM_PROCESSORS && !(named[r->core] & (1 << r->track))) {
+            if (named[r->core] == 0) {
+                fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,", r->core);
+                fprintf(out, "\"args\":{\"name\":\"core %d\"}},\n", r->core);
+            }
+            named[r->core] |= 1 << r->track;
+            write_track_name(out, r->core, r->track);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const TraceRecord_t* r = &records[(first + i) % capacity];
+        fprintf(
+            out,
+            "{\"name\":\"%s\",\"cat\":\"epdiy\",\"pid\":%d,\"tid\":%d,\"ts\":%lu,",
+            event_info[r->event].name,
+            r->core,
+            r->track,
+            (unsigned long)r->start
+        );
+        if (r->duration == INSTANT) {
+            fprintf(out, "\"ph\":\"i\",\"s\":\"t\",");
+        } else {
+            fprintf(out, "\"ph\":\"X\",\"dur\":%lu,", (unsigned long)r->duration);
+        }
+        fprintf(
+            out,
+            "\"args\":{\"%s\":%u}}%s\n",
+            event_info[r->event].arg_name,
+            r->arg,
+            i < count - 1 ? "," : ""
+        );
+    }
+    fprintf(out, "]}\n");
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <esp_attr.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../epdiy.h"
+
+/**
+ * Recording of pipeline events for `epd_trace_start()`.
+ *
+ * Spans are recorded when they end, with their start time from `epd_trace_begin()`.
+ * While tracing is disabled, this costs a check of `epd_trace_enabled`.
+ */
+
+/// Events of the update pipeline.
+enum EpdTraceEvent {
+    /// A whole update with `epd_draw_base()`, on the update track.
+    EPD_TRACE_UPDATE,
+    /// Difference image calculation in `epd_hl_update_area()`.
+    EPD_TRACE_DIFF,
+    /// Copy of the front buffer to the back buffer in `epd_hl_update_area()`.
+    EPD_TRACE_BUFFER_SYNC,
+    /// A frame, from starting the render workers until it was output.
+    EPD_TRACE_FRAME,
+    /// Instant at which the output of a frame finished.
+    EPD_TRACE_FRAME_DONE,
+    /// Building the LUT of a frame.
+    EPD_TRACE_LUT_BUILD,
+    /// A render worker working on a frame.
+    EPD_TRACE_FEED_FRAME,
+    /// A render worker preparing a chunk of lines, the argument is the first line.
+    EPD_TRACE_FEED_CHUNK,
+    /// A render worker waiting for space in its line queue.
+    EPD_TRACE_QUEUE_WAIT,
+    /// Passing a prepared line to the output peripheral.
+    EPD_TRACE_LINE_OUTPUT,
+    EPD_TRACE_EVENT_COUNT,
+};
+
+/// Track of the task calling `epd_draw_base()`. Render workers use their index as track.
+#define EPD_TRACE_TRACK_UPDATE EPD_MAX_RENDER_WORKERS
+/// Track of the LCD line ISR.
+#define EPD_TRACE_TRACK_ISR (EPD_MAX_RENDER_WORKERS + 1)
+
+extern volatile bool epd_trace_enabled;
+
+/// Current trace time in us, never 0.
+uint32_t epd_trace_time();
+
+/// Start of a span, 0 if tracing is disabled.
+static inline uint32_t epd_trace_begin() {
+    return epd_trace_enabled ? epd_trace_time() : 0;
+}
+
+/// Record a span from `start` until now. Ignored if the span began while not tracing.
+void epd_trace_record(enum EpdTraceEvent event, int track, int arg, uint32_t start);
+
+/// Record the end of a span started with `epd_trace_begin()`.
+static inline void epd_trace_end(enum EpdTraceEvent event, int track, int arg, uint32_t start) {
+    if (start != 0 && epd_trace_enabled) {
+        epd_trace_record(event, track, arg, start);
+    }
+}
+
+/// Record an instant event.
+static inline void epd_trace_instant(enum EpdTraceEvent event, int track, int arg) {
+    if (epd_trace_enabled) {
+        epd_trace_record(event, track, arg, 0);
+    }
+}
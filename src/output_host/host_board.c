@@ -0,0 +1,34 @@
+#include "../output_common/render_method.h"
+
+#ifdef RENDER_METHOD_HOST
+
+#include "epd_board.h"
+
+static void host_board_init(uint32_t epd_row_width) {}
+
+static void host_board_deinit() {}
+
+static void host_board_set_ctrl(epd_ctrl_state_t* state, const epd_ctrl_state_t* const mask) {}
+
+static void host_board_poweron(epd_ctrl_state_t* state) {}
+
+static void host_board_poweroff(epd_ctrl_state_t* state) {}
+
+static float host_board_temperature() {
+    return 25.0;
+}
+
+const EpdBoardDefinition epd_board_host = {
+    .init = host_board_init,
+    .deinit = host_board_deinit,
+    .set_ctrl = host_board_set_ctrl,
+    .poweron = host_board_poweron,
+    .poweroff = host_board_poweroff,
+    .get_temperature = host_board_temperature,
+    .set_vcom = NULL,
+    .gpio_set_direction = NULL,
+    .gpio_read = NULL,
+    .gpio_write = NULL,
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "../output_common/render_method.h"
+
+#ifdef RENDER_METHOD_HOST
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "panel_model.h"
+
+static inline uint8_t gray8(float state) {
+    return (uint8_t)lrintf(state * 255.0f);
+}
+
+bool epd_panel_model_init(EpdPanelModel* model, int width, int height) {
+    memset(model, 0, sizeof(EpdPanelModel));
+    model->state = heap_caps_malloc((size_t)width * height * sizeof(float), MALLOC_CAP_DEFAULT);
+    if (model->state == NULL) {
+        return false;
+    }
+    model->width = width;
+    model->height = height;
+    model->tau_dark_us = EPD_PANEL_MODEL_DEFAULT_TAU_US;
+    model->tau_white_us = EPD_PANEL_MODEL_DEFAULT_TAU_US;
+    for (int i = 0; i < width * height; i++) {
+        model->state[i] = 1.0f;
+    }
+    return true;
+}
+
+void epd_panel_model_free(EpdPanelModel* model) {
+    heap_caps_free(model->state);
+    model->state = NULL;
+}
+
+void epd_panel_model_set_image(EpdPanelModel* model, const uint8_t* framebuffer) {
+    for (int i = 0; i < model->width * model->height; i++) {
+        uint8_t value = (framebuffer[i / 2] >> (4 * (i % 2))) & 0x0F;
+        model->state[i] = value / 15.0f;
+    }
+    model->frames = 0;
+    model->update_time_us = 0.0;
+}
+
+double epd_panel_model_apply_frame(
+    EpdPanelModel* model, const uint8_t* lines, int line_bytes, int scanned_lines, int line_time
+) {
+    double frame_us = scanned_lines * line_time / 10.0;
+
+    // fraction of the remaining distance to black / white covered in this frame
+    float darken = 1.0f - expf(-frame_us / model->tau_dark_us);
+    float lighten = 1.0f - expf(-frame_us / model->tau_white_us);
+
+    int pixels = line_bytes * 4 < model->width ? line_bytes * 4 : model->width;
+    for (int y = 0; y < scanned_lines && y < model->height; y++) {
+        const uint8_t* line = lines + y * line_bytes;
+        float* state = model->state + y * model->width;
+        for (int x = 0; x < pixels; x++) {
+            switch ((line[x / 4] >> (2 * (x % 4))) & 3) {
+                case 1:
+                    state[x] -= state[x] * darken;
+                    break;
+                case 2:
+                    state[x] += (1.0f - state[x]) * lighten;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    model->frames++;
+    model->update_time_us += frame_us;
+    return frame_us;
+}
+
+double epd_panel_model_apply_capture(
+    EpdPanelModel* model, const EpdHostCapture* capture, const char* pgm_prefix
+) {
+    double time_us = 0.0;
+    size_t frame_bytes = (size_t)capture->lines * capture->line_bytes;
+    for (int f = 0; f < capture->frames; f++) {
+        time_us += epd_panel_model_apply_frame(
+            model,
+            capture->data + f * frame_bytes,
+            capture->line_bytes,
+            capture->frame_lines[f],
+            capture->frame_times[f]
+        );
+
+        if (pgm_prefix != NULL) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s%03d.pgm", pgm_prefix, f);
+            if (!epd_panel_model_write_pgm(model, path)) {
+                ESP_LOGE("epd_panel_model", "could not write %s", path);
+            }
+        }
+    }
+    return time_us;
+}
+
+void epd_panel_model_image(const EpdPanelModel* model, uint8_t* image) {
+    for (int i = 0; i < model->width * model->height; i++) {
+        image[i] = gray8(model->state[i]);
+    }
+}
+
+bool epd_panel_model_write_pgm(const EpdPanelModel* model, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint8_t row[model->width];
+    fprintf(file, "P5\n%d %d\n255\n", model->width, model->height);
+    for (int y = 0; y < model->height; y++) {
+        for (int x = 0; x < model->width; x++) {
+            row[x] = gray8(model->state[y * model->width + x]);
+        }
+        fwrite(row, 1, model->width, file);
+    }
+    return fclose(file) == 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "render_host.h"
+
+/**
+ * Time constant of the particle movement in µs, fitted to the grayscale steps
+ * of the builtin ED097TC2 GC16 waveform.
+ */
+#define EPD_PANEL_MODEL_DEFAULT_TAU_US 6700.0f
+
+/**
+ * Model of the optical state of an electrophoretic panel, driven by
+ * the captured output of the host render method.
+ *
+ * Each pixel holds the voltage it was driven with until its line is scanned
+ * again in the next frame. While driven, its state approaches black or white
+ * exponentially. No-op pixels keep their state.
+ */
+typedef struct {
+    int width;
+    int height;
+    /// Optical state of each pixel, from 0 (black) to 1 (white).
+    float* state;
+    /// Time constant for darkening pixels in µs.
+    float tau_dark_us;
+    /// Time constant for lightening pixels in µs.
+    float tau_white_us;
+    /// Number of frames applied since the last image was set.
+    int frames;
+    /// Total duration of the frames applied since the last image was set, in µs.
+    double update_time_us;
+} EpdPanelModel;
+
+/**
+ * Initialize a panel model with all pixels white.
+ * Returns false if memory could not be allocated.
+ */
+bool epd_panel_model_init(EpdPanelModel* model, int width, int height);
+
+/**
+ * Free the memory of a panel model.
+ */
+void epd_panel_model_free(EpdPanelModel* model);
+
+/**
+ * Set the optical state from a 4bpp framebuffer and reset the frame count and time.
+ */
+void epd_panel_model_set_image(EpdPanelModel* model, const uint8_t* framebuffer);
+
+/**
+ * Drive the panel with one frame of 2-bit pixel actions, in the format output to the display.
+ *
+ * @param lines: `model->height` lines of `line_bytes` bytes.
+ * @param scanned_lines: The number of lines scanned in this frame.
+ * @param line_time: Time per line in 1/10ths of µs.
+ * @returns The duration of the frame in µs.
+ */
+double epd_panel_model_apply_frame(
+    EpdPanelModel* model, const uint8_t* lines, int line_bytes, int scanned_lines, int line_time
+);
+
+/**
+ * Drive the panel with all frames of a capture.
+ *
+ * @param pgm_prefix: If not NULL, the predicted image after each frame is written
+ *      to `<pgm_prefix>NNN.pgm`, with NNN the index of the frame.
+ * @returns The duration of the update in µs.
+ */
+double epd_panel_model_apply_capture(
+    EpdPanelModel* model, const EpdHostCapture* capture, const char* pgm_prefix
+);
+
+/**
+ * Get the predicted image as 8 bit grayscale, one byte per pixel.
+ */
+void epd_panel_model_image(const EpdPanelModel* model, uint8_t* image);
+
+/**
+ * Write the predicted image as 8 bit binary PGM.
+ * Returns false if the file could not be written.
+ */
+bool epd_panel_model_write_pgm(const EpdPanelModel* model, const char* path);
@@ -0,0 +1,289 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../output_common/render_method.h"
+
+#ifdef RENDER_METHOD_HOST
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
+
+#include "../epd_internals.h"
+#include "../output_common/line_queue.h"
+#include "../output_common/lut.h"
+#include "../output_common/render_context.h"
+#include "../output_common/trace.h"
+#include "epd_board.h"
+#include "epdiy.h"
+#include "render_host.h"
+
+static bool capture_enabled = false;
+static EpdHostCapture capture = { 0 };
+/// Number of frames `capture` has space for.
+static int capture_capacity = 0;
+
+void epd_host_set_capture(bool enable) {
+    capture_enabled = enable;
+}
+
+const EpdHostCapture* epd_host_capture() {
+    return &capture;
+}
+
+void host_deinit() {
+    heap_caps_free(capture.data);
+    heap_caps_free(capture.frame_times);
+    heap_caps_free(capture.frame_numbers);
+    heap_caps_free(capture.frame_lines);
+    heap_caps_free(capture.frame_first_lines);
+    heap_caps_free(capture.frame_durations);
+    memset(&capture, 0, sizeof(capture));
+    capture_capacity = 0;
+}
+
+static void capture_reset(RenderContext_t* ctx) {
+    capture.frames = 0;
+    capture.lines = ctx->display_height;
+    capture.line_bytes = ctx->display_width / 4;
+}
+
+/**
+ * Space for the lines of the next captured frame of `lines` scanned lines,
+ * of which the first `first_line` are skipped, cleared to no-op lines.
+ * NULL if recording is disabled.
+ */
+static uint8_t* capture_next_frame(RenderContext_t* ctx, int first_line, int lines) {
+    if (!capture_enabled) {
+        return NULL;
+    }
+
+    size_t frame_bytes = (size_t)capture.lines * capture.line_bytes;
+    if (capture.frames >= capture_capacity) {
+        int capacity = capture_capacity > 0 ? 2 * capture_capacity : 16;
+        uint8_t* data = heap_caps_realloc(capture.data, capacity * frame_bytes, MALLOC_CAP_DEFAULT);
+        int* times
+            = heap_caps_realloc(capture.frame_times, capacity * sizeof(int), MALLOC_CAP_DEFAULT);
+        int* numbers
+            = heap_caps_realloc(capture.frame_numbers, capacity * sizeof(int), MALLOC_CAP_DEFAULT);
+        int* lines
+            = heap_caps_realloc(capture.frame_lines, capacity * sizeof(int), MALLOC_CAP_DEFAULT);
+        int* first_lines = heap_caps_realloc(
+            capture.frame_first_lines, capacity * sizeof(int), MALLOC_CAP_DEFAULT
+        );
+        int* durations = heap_caps_realloc(
+            capture.frame_durations, capacity * sizeof(int), MALLOC_CAP_DEFAULT
+        );
+        if (data != NULL) {
+            capture.data = data;
+        }
+        if (times != NULL) {
+            capture.frame_times = times;
+        }
+        if (numbers != NULL) {
+            capture.frame_numbers = numbers;
+        }
+        if (lines != NULL) {
+            capture.frame_lines = lines;
+        }
+        if (first_lines != NULL) {
+            capture.frame_first_lines = first_lines;
+        }
+        if (durations != NULL) {
+            capture.frame_durations = durations;
+        }
+        if (data == NULL || times == NULL || numbers == NULL || lines == NULL
+            || first_lines == NULL || durations == NULL) {
+            ESP_LOGE("epd_host", "could not allocate space for captured frames!");
+            return NULL;
+        }
+        capture_capacity = capacity;
+    }
+
+    uint8_t* frame = capture.data + capture.frames * frame_bytes;
+    memset(frame, 0x00, frame_bytes);
+    capture.frame_times[capture.frames] = ctx->frame_time;
+    capture.frame_numbers[capture.frames] = ctx->current_frame;
+    capture.frame_lines[capture.frames] = lines;
+    capture.frame_first_lines[capture.frames] = first_line;
+    capture.frame_durations[capture.frames]
+        = first_line * SKIP_LINE_TIME + (lines - first_line) * ctx->frame_time;
+    capture.frames++;
+    return frame;
+}
+
+/**
+ * Consume the lines of the current frame in display order, as the LCD peripheral does.
+ * Unlike the peripheral, the consumer waits for lines which are not ready yet.
+ * The lines above `lines_first` are skipped and left as no-op lines.
+ */
+static void host_output_frame(RenderContext_t* ctx) {
+    uint8_t* frame = capture_next_frame(ctx, ctx->lines_first, ctx->lines_total);
+    int line_bytes = ctx->display_width / 4;
+
+    uint32_t output_cycles = 0;
+
+    for (int l = ctx->lines_first; l < ctx->lines_total; l++) {
+        uint8_t thread = __atomic_load_n(&ctx->line_threads[l], __ATOMIC_ACQUIRE);
+        bool underrun = thread == LINE_NOT_TAKEN;
+        while (thread == LINE_NOT_TAKEN) {
+            vTaskDelay(0);
+            thread = __atomic_load_n(&ctx->line_threads[l], __ATOMIC_ACQUIRE);
+        }
+        assert(thread < ctx->num_feed_tasks);
+
+        LineQueue_t* lq = &ctx->line_queues[thread];
+        const uint8_t* line = lq_peek(lq);
+        underrun |= line == NULL;
+        while (line == NULL) {
+            vTaskDelay(0);
+            line = lq_peek(lq);
+        }
+        epd_stats_output_line(ctx, lq, underrun);
+        uint32_t start_cycles = XTHAL_GET_CCOUNT();
+        uint32_t trace_start = epd_trace_begin();
+        // lines are only copied when recording
+        if (frame != NULL && l < ctx->display_height) {
+            memcpy(frame + l * line_bytes, line, line_bytes);
+        }
+        lq_release(lq);
+        ctx->lines_consumed += 1;
+
+        if (epd_feed_needs_wake(ctx, thread)) {
+            xSemaphoreGive(ctx->queue_space_smphr[thread]);
+        }
+        output_cycles += XTHAL_GET_CCOUNT() - start_cycles;
+        epd_trace_end(EPD_TRACE_LINE_OUTPUT, EPD_TRACE_TRACK_UPDATE, l, trace_start);
+    }
+    epd_trace_instant(EPD_TRACE_FRAME_DONE, EPD_TRACE_TRACK_UPDATE, ctx->current_frame);
+
+    EpdFrameStats* stats = epd_frame_stats(ctx, ctx->current_frame);
+    if (stats != NULL) {
+        stats->output_cycles = output_cycles;
+    }
+}
+
+void host_do_update(RenderContext_t* ctx) {
+    epd_set_mode(1);
+    capture_reset(ctx);
+
+    for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
+        if (!epd_frame_is_active(ctx, k)) {
+            ctx->current_frame++;
+            continue;
+        }
+        prepare_context_for_next_frame(ctx);
+        memset(ctx->line_threads, LINE_NOT_TAKEN, ctx->lines_total);
+
+        int64_t start_us = esp_timer_get_time();
+        uint32_t trace_start = epd_trace_begin();
+        epd_start_feed_tasks(ctx);
+
+        host_output_frame(ctx);
+
+        for (int i = 0; i < ctx->num_feed_tasks; i++) {
+            xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
+        }
+        epd_stats_frame_done(ctx, start_us);
+        epd_trace_end(EPD_TRACE_FRAME, EPD_TRACE_TRACK_UPDATE, ctx->current_frame, trace_start);
+
+        ctx->current_frame++;
+        // the frame ended with a no-op line, so the next ones can skip the lines above the drawn
+        ctx->lines_first = ctx->lines_skippable;
+    }
+
+    epd_set_mode(0);
+}
+
+void epd_push_pixels_host(RenderContext_t* ctx, short time, int color) {
+    int line_bytes = ctx->display_width / 4;
+    int fill_byte = 0;
+    switch (color) {
+        case 0:
+            fill_byte = DARK_BYTE;
+            break;
+        case 1:
+            fill_byte = CLEAR_BYTE;
+            break;
+        default:
+            fill_byte = 0x00;
+    }
+
+    // restrict the pattern to the columns of the area
+    uint8_t line[line_bytes];
+    memset(line, 0, line_bytes);
+    for (int x = ctx->area.x; x < ctx->area.x + ctx->area.width && x < ctx->display_width; x++) {
+        line[x / 4] |= fill_byte & (0x03 << (2 * (x % 4)));
+    }
+
+    epd_set_mode(1);
+    capture_reset(ctx);
+    ctx->current_frame = 0;
+    ctx->frame_time = time * 10;
+    uint8_t* frame = capture_next_frame(ctx, 0, ctx->display_height);
+    if (frame != NULL) {
+        for (int l = ctx->area.y; l < ctx->area.y + ctx->area.height; l++) {
+            if (l >= 0 && l < ctx->display_height) {
+                memcpy(frame + l * line_bytes, line, line_bytes);
+            }
+        }
+    }
+    epd_set_mode(0);
+}
+
+__attribute__((optimize("O3"))) void host_calculate_frame(RenderContext_t* ctx, int thread_id) {
+    assert(ctx->lut_lookup_func != NULL);
+    LineQueue_t* lq = &ctx->line_queues[thread_id];
+    int l = 0;
+
+    int min_y, max_y, bytes_per_line, _ppB;
+    const uint8_t* ptr_start;
+    get_buffer_params(ctx, &bytes_per_line, &ptr_start, &min_y, &max_y, &_ppB);
+
+    // as with the LCD method, only full-width updates are supported
+    assert(ctx->area.width == ctx->display_width && ctx->area.x == 0);
+
+    if (ctx->error) {
+        ESP_LOGW("epd_host", "draw frame draw initiated, but an error flag is set: %X", ctx->error);
+    }
+
+    int driven = 0, skipped = 0;
+    while ((l = epd_next_feed_line(ctx, thread_id)) >= 0) {
+        __atomic_store_n(&ctx->line_threads[l], thread_id, __ATOMIC_RELEASE);
+
+        // output no-op lines in case of errors, so the frame is still completed
+        if (ctx->error || l < min_y || l >= max_y || epd_line_is_skipped(ctx, l)) {
+            uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
+            memset(buf, 0x00, lq->element_size);
+            lq_commit(lq);
+            skipped++;
+            continue;
+        }
+
+        const uint32_t* lp;
+        const uint8_t* ptr = ptr_start + bytes_per_line * (l - min_y);
+        if (ctx->from_ptr != NULL) {
+            const uint8_t* from = ctx->from_ptr + (ptr - ctx->data_ptr);
+            lp = epd_interlace_feed_line(ctx, thread_id, ptr, from);
+        } else {
+            lp = (const uint32_t*)ptr;
+        }
+
+        uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
+        epd_lookup_line(ctx, lp, buf);
+        epd_apply_line_mask(
+            buf + ctx->span_x / 4, ctx->line_mask + ctx->span_x / 4, ctx->span_width / 4
+        );
+        lq_commit(lq);
+        driven++;
+    }
+
+    epd_stats_feed_lines(ctx, driven, skipped);
+
+    // all lines of this frame are taken, prepare the next one
+    epd_build_next_lut(ctx, thread_id);
+}
+
+#endif
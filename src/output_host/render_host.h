@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../output_common/render_context.h"
+
+/**
+ * Drive data output to the simulated panel, recorded with `epd_host_set_capture()`.
+ */
+typedef struct {
+    /// Number of frames output since the start of the last update.
+    int frames;
+    /// Number of lines per frame, the display height.
+    int lines;
+    /// Bytes per line, with four 2-bit pixel actions per byte as output to the display.
+    int line_bytes;
+    /// `frames * lines * line_bytes` bytes of line data. Lines which were not
+    /// driven in a frame are all-zero (no-op) lines.
+    uint8_t* data;
+    /// Time per line of each frame in 1/10ths of us.
+    int* frame_times;
+    /// Waveform frame number of each output frame. Skipped frames are not output.
+    int* frame_numbers;
+    /// Number of lines scanned in each frame, lines below are not driven.
+    int* frame_lines;
+    /// Number of leading lines of each frame which are skipped with gate-only clock pulses
+    /// instead of being output, as the LCD output does.
+    int* frame_first_lines;
+    /// Modeled time of each frame in 1/10ths of us: `SKIP_LINE_TIME` per skipped line
+    /// and the time per line for each output line.
+    int* frame_durations;
+} EpdHostCapture;
+
+/**
+ * Enable or disable recording the drive data of updates.
+ * When enabled, every update replaces the previous capture.
+ */
+void epd_host_set_capture(bool enable);
+
+/**
+ * The drive data of the last update, if recording is enabled.
+ */
+const EpdHostCapture* epd_host_capture();
+
+/**
+ * Lighten / darken pixels on the simulated panel.
+ */
+void epd_push_pixels_host(RenderContext_t* ctx, short time, int color);
+
+/**
+ * Do a full update cycle with a configured context.
+ */
+void host_do_update(RenderContext_t* ctx);
+
+/**
+ * Worker thread for output calculation.
+ * As with the LCD method, both threads do the same thing.
+ */
+void host_calculate_frame(RenderContext_t* ctx, int thread_id);
+
+/**
+ * Free the recorded drive data.
+ */
+void host_deinit();
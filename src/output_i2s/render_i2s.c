@@ -7,6 +7,8 @@
 #include <string.h>
 
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
 
 #include "epd_internals.h"
 #include "epdiy.h"
@@ -14,6 +16,7 @@
 // output a row to the display.
 #include "../output_common/lut.h"
 #include "../output_common/render_context.h"
+#include "../output_common/trace.h"
 #include "i2s_data_bus.h"
 #include "rmt_pulse.h"
 
@@ -158,18 +161,25 @@ static void i2s_end_frame() {
 
 void i2s_do_update(RenderContext_t* ctx) {
     for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
+        if (!epd_frame_is_active(ctx, k)) {
+            ctx->current_frame++;
+            continue;
+        }
         prepare_context_for_next_frame(ctx);
+        memset(ctx->line_threads, LINE_NOT_TAKEN, ctx->lines_total);
 
-        // start both feeder tasks
-        xTaskNotifyGive(ctx->feed_tasks[!xPortGetCoreID()]);
-        xTaskNotifyGive(ctx->feed_tasks[xPortGetCoreID()]);
+        int64_t start_us = esp_timer_get_time();
+        uint32_t trace_start = epd_trace_begin();
+        epd_start_feed_tasks(ctx);
 
         // transmission is started in renderer threads, now wait util it's done
         xSemaphoreTake(ctx->frame_done, portMAX_DELAY);
 
-        for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+        for (int i = 0; i < ctx->num_feed_tasks; i++) {
             xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
         }
+        epd_stats_frame_done(ctx, start_us);
+        epd_trace_end(EPD_TRACE_FRAME, EPD_TRACE_TRACK_UPDATE, ctx->current_frame, trace_start);
 
         ctx->current_frame++;
 
@@ -222,39 +232,60 @@ void IRAM_ATTR epd_push_pixels_i2s(RenderContext_t* ctx, EpdRect area, short tim
 }
 
 void IRAM_ATTR i2s_output_frame(RenderContext_t* ctx, int thread_id) {
-    uint8_t* line_buf = ctx->feed_line_buffers[thread_id];
-
     ctx->skipping = 0;
-    EpdRect area = ctx->area;
     int frame_time = ctx->frame_time;
+    uint32_t output_cycles = 0;
 
     i2s_start_frame();
-    for (int i = 0; i < ctx->display_height; i++) {
-        LineQueue_t* lq = &ctx->line_queues[0];
-
-        memset(line_buf, 0, ctx->display_width);
-        while (lq_read(lq, line_buf) < 0) {
+    // lines below the drawn area are not scanned at all
+    for (int i = 0; i < ctx->lines_total; i++) {
+        uint8_t thread = __atomic_load_n(&ctx->line_threads[i], __ATOMIC_ACQUIRE);
+        bool underrun = thread == LINE_NOT_TAKEN;
+        while (thread == LINE_NOT_TAKEN) {
+            thread = __atomic_load_n(&ctx->line_threads[i], __ATOMIC_ACQUIRE);
         };
+        assert(thread < ctx->num_feed_tasks);
+        LineQueue_t* lq = &ctx->line_queues[thread];
+
+        // the line is looked up directly from the queue
+        const uint8_t* line_buf = lq_peek(lq);
+        underrun |= line_buf == NULL;
+        while (line_buf == NULL) {
+            line_buf = lq_peek(lq);
+        };
+        epd_stats_output_line(ctx, lq, underrun);
+        uint32_t start_cycles = XTHAL_GET_CCOUNT();
+        uint32_t trace_start = epd_trace_begin();
 
         ctx->lines_consumed += 1;
 
-        if (ctx->drawn_lines != NULL && !ctx->drawn_lines[i - area.y]) {
+        if (epd_line_is_skipped(ctx, i)) {
+            lq_release(lq);
+            if (epd_feed_needs_wake(ctx, thread)) {
+                xSemaphoreGive(ctx->queue_space_smphr[thread]);
+            }
+            output_cycles += XTHAL_GET_CCOUNT() - start_cycles;
+            epd_trace_end(EPD_TRACE_LINE_OUTPUT, thread_id, i, trace_start);
             i2s_skip_row(ctx, frame_time);
             continue;
         }
 
         // lookup pixel actions in the waveform LUT
-        ctx->lut_lookup_func(
-            (uint32_t*)line_buf,
-            (uint8_t*)i2s_get_current_buffer(),
-            ctx->conversion_lut,
-            ctx->display_width
-        );
+        uint8_t* out = (uint8_t*)i2s_get_current_buffer();
+        epd_lookup_line(ctx, (const uint32_t*)line_buf, out);
+        lq_release(lq);
+        if (epd_feed_needs_wake(ctx, thread)) {
+            xSemaphoreGive(ctx->queue_space_smphr[thread]);
+        }
 
-        // apply the line mask
-        epd_apply_line_mask(i2s_get_current_buffer(), ctx->line_mask, ctx->display_width / 4);
+        // apply the line mask within the looked up span
+        epd_apply_line_mask(
+            out + ctx->span_x / 4, ctx->line_mask + ctx->span_x / 4, ctx->span_width / 4
+        );
 
-        reorder_line_buffer((uint32_t*)i2s_get_current_buffer(), ctx->display_width / 4);
+        reorder_line_buffer((uint32_t*)out, ctx->display_width / 4);
+        output_cycles += XTHAL_GET_CCOUNT() - start_cycles;
+        epd_trace_end(EPD_TRACE_LINE_OUTPUT, thread_id, i, trace_start);
         i2s_write_row(ctx, frame_time);
     }
     if (!ctx->skipping) {
@@ -264,6 +295,12 @@ void IRAM_ATTR i2s_output_frame(RenderContext_t* ctx, int thread_id) {
     }
     i2s_end_frame();
 
+    EpdFrameStats* stats = epd_frame_stats(ctx, ctx->current_frame);
+    if (stats != NULL) {
+        stats->output_cycles = output_cycles;
+    }
+
+    epd_trace_instant(EPD_TRACE_FRAME_DONE, thread_id, ctx->current_frame);
     xSemaphoreGive(ctx->feed_done_smphr[thread_id]);
     xSemaphoreGive(ctx->frame_done);
 }
@@ -302,25 +339,27 @@ void IRAM_ATTR i2s_fetch_frame_data(RenderContext_t* ctx, int thread_id) {
     line_end_x = min(max(line_end_x, 0), ctx->display_width);
 
     int l = 0;
-    while (l = atomic_fetch_add(&ctx->lines_prepared, 1), l < ctx->display_height) {
+    int driven = 0, skipped = 0;
+    while ((l = epd_next_feed_line(ctx, thread_id)) >= 0) {
         // if (thread_id) gpio_set_level(15, 0);
-        ctx->line_threads[l] = thread_id;
+        __atomic_store_n(&ctx->line_threads[l], thread_id, __ATOMIC_RELEASE);
 
-        if (l < min_y || l >= max_y
-            || (ctx->drawn_lines != NULL && !ctx->drawn_lines[l - area.y])) {
-            uint8_t* buf = NULL;
-            while (buf == NULL)
-                buf = lq_current(lq);
+        if (l < min_y || l >= max_y || epd_line_is_skipped(ctx, l)) {
+            uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
             memset(buf, 0x00, lq->element_size);
             lq_commit(lq);
+            skipped++;
             continue;
         }
 
-        uint32_t* lp = (uint32_t*)input_line;
+        const uint32_t* lp = (uint32_t*)input_line;
         bool shifted = false;
         const uint8_t* ptr = ptr_start + bytes_per_line * (l - min_y);
 
-        if (area.width == ctx->display_width && area.x == 0 && !ctx->error) {
+        if (ctx->from_ptr != NULL && !ctx->error) {
+            const uint8_t* from = ctx->from_ptr + (ptr - ctx->data_ptr);
+            lp = epd_interlace_feed_line(ctx, thread_id, ptr, from);
+        } else if (area.width == ctx->display_width && area.x == 0 && !ctx->error) {
             lp = (uint32_t*)ptr;
         } else if (!ctx->error) {
             uint8_t* buf_start = (uint8_t*)input_line;
@@ -357,6 +396,20 @@ void IRAM_ATTR i2s_fetch_frame_data(RenderContext_t* ctx, int thread_id) {
                     // shift one nibble to right
                     nibble_shift_buffer_right(buf_start, to_shift);
                 }
+                // consider two-bit shifts in four-pixel-per-byte mode
+            } else if (pixels_per_byte == 4) {
+                // mask the padding pixels of the last byte
+                if (cropped_width % 4 != 0 && bytes_per_line + 1 < ctx->display_width) {
+                    *(buf_start + line_bytes - 1) |= 0xFF << (2 * (cropped_width % 4));
+                }
+
+                if (min_x % 4 != 0 && min_x < ctx->display_width) {
+                    shifted = true;
+                    uint32_t remaining
+                        = (uint32_t)input_line + ctx->display_width / 4 - (uint32_t)buf_start;
+                    uint32_t to_shift = min(line_bytes + 1, remaining);
+                    crumb_shift_buffer_right(buf_start, to_shift, min_x % 4);
+                }
                 // consider bit shifts in bit buffers
             } else if (pixels_per_byte == 8) {
                 // mask last n bits if width is not divisible by 8
@@ -380,18 +433,21 @@ void IRAM_ATTR i2s_fetch_frame_data(RenderContext_t* ctx, int thread_id) {
             lp = (uint32_t*)input_line;
         }
 
-        uint8_t* buf = NULL;
-        while (buf == NULL)
-            buf = lq_current(lq);
-
+        uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
         memcpy(buf, lp, lq->element_size);
 
         lq_commit(lq);
+        driven++;
 
         if (shifted) {
             memset(input_line, 255, ctx->display_width / pixels_per_byte);
         }
     }
+
+    epd_stats_feed_lines(ctx, driven, skipped);
+
+    // the output thread still uses the current LUT, prepare the next one meanwhile
+    epd_build_next_lut(ctx, thread_id);
 }
 
 void i2s_deinit() {
@@ -72,6 +72,11 @@ static inline int max(int x, int y) {
 
 #define RMT_CKV_CHAN RMT_CHANNEL_1
 
+// CKV high and low time in 1/10us when skipping lines without output.
+// According to the spec, the OC4 maximum CKV frequency is 200kHz.
+#define SKIP_CKV_HIGH_TIME 45
+#define SKIP_CKV_LOW_TIME 5
+
 // The extern line is declared in esp-idf/components/driver/deprecated/rmt_legacy.c. It has access
 // to RMTMEM through the rmt_private.h header which we can't access outside the sdk. Declare our own
 // extern here to properly use the RMTMEM smybol defined in
@@ -122,6 +127,10 @@ typedef struct {
 
     /// The number of lines of the display
     int display_lines;
+    /// The number of lines driven in a frame, see `epd_lcd_set_frame_lines()`.
+    int frame_lines;
+    /// The number of leading lines skipped with gate-only CKV pulses.
+    int first_line;
 } s3_lcd_t;
 
 static s3_lcd_t lcd = { 0 };
@@ -162,18 +171,25 @@ static void start_ckv_cycles(int cycles) {
 }
 
 /**
- * Build the RMT signal according to the timing set in the lcd object.
+ * Build a CKV pulse of `high_time` and `low_time` in 1/10us in the RMT memory.
  */
-static void ckv_rmt_build_signal() {
-    int low_time = (lcd.line_length_us * 10 - lcd.config.ckv_high_time);
+static void IRAM_ATTR ckv_rmt_build_pulse(int high_time, int low_time) {
     volatile rmt_item32_t* rmt_mem_ptr = &(RMTMEM.chan[RMT_CKV_CHAN].data32[0]);
-    rmt_mem_ptr->duration0 = lcd.config.ckv_high_time;
+    rmt_mem_ptr->duration0 = high_time;
     rmt_mem_ptr->level0 = 1;
     rmt_mem_ptr->duration1 = low_time;
     rmt_mem_ptr->level1 = 0;
     rmt_mem_ptr[1].val = 0;
 }
 
+/**
+ * Build the RMT signal according to the timing set in the lcd object.
+ */
+static void IRAM_ATTR ckv_rmt_build_signal() {
+    int low_time = (lcd.line_length_us * 10 - lcd.config.ckv_high_time);
+    ckv_rmt_build_pulse(lcd.config.ckv_high_time, low_time);
+}
+
 /**
  * Configure the RMT peripheral for use as the CKV clock.
  */
@@ -220,7 +236,8 @@ __attribute__((optimize("O3"))) IRAM_ATTR static void lcd_isr_vsync(void* args)
     lcd_ll_clear_interrupt_status(lcd.hal.dev, intr_status);
 
     if (intr_status & LCD_LL_EVENT_VSYNC_END) {
-        int batches_needed = lcd.display_lines / LINE_BATCH;
+        int output_lines = lcd.frame_lines - lcd.first_line;
+        int batches_needed = output_lines / LINE_BATCH;
         if (lcd.batches >= batches_needed) {
             lcd_ll_stop(lcd.hal.dev);
             if (lcd.frame_done_cb != NULL) {
@@ -231,8 +248,8 @@ __attribute__((optimize("O3"))) IRAM_ATTR static void lcd_isr_vsync(void* args)
             // last batch
             if (lcd.batches == batches_needed - 1) {
                 lcd_ll_enable_auto_next_frame(lcd.hal.dev, false);
-                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, lcd.display_lines % LINE_BATCH, 10);
-                ckv_cycles = lcd.display_lines % LINE_BATCH + 10;
+                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, output_lines % LINE_BATCH, 10);
+                ckv_cycles = output_lines % LINE_BATCH + 10;
             } else {
                 lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, LINE_BATCH, 1);
                 ckv_cycles = LINE_BATCH + 1;
@@ -417,6 +434,8 @@ static void assign_lcd_parameters_from_config(
 
     // Make sure the bounce buffers divide the display height evenly.
     lcd.display_lines = (((display_height + 7) / 8) * 8);
+    lcd.frame_lines = lcd.display_lines;
+    lcd.first_line = 0;
 
     lcd.line_bytes = display_width / 4;
     lcd.lcd_res_h = lcd.line_bytes / (lcd.config.bus_width / 8);
@@ -643,8 +662,35 @@ void epd_lcd_set_pixel_clock_MHz(int frequency) {
     ckv_rmt_build_signal();
 }
 
+void epd_lcd_set_frame_lines(int first_line, int end_line) {
+    // Make sure the bounce buffers divide the frame evenly.
+    end_line = ((end_line + 7) / 8) * 8;
+    lcd.frame_lines = max(8, min(end_line, lcd.display_lines));
+    lcd.first_line = max(0, min(first_line / 8 * 8, lcd.frame_lines - 8));
+}
+
+/**
+ * Advance the gate driver past the first `lcd.first_line` lines with short CKV pulses,
+ * while the LCD peripheral is not running. No line is latched in the meantime,
+ * so the source driver keeps outputting the no-op line that ended the last frame.
+ * Leaves the vertical start pulse released, as at the end of the frame start sequence.
+ */
+static void IRAM_ATTR skip_first_lines() {
+    int period_us = (SKIP_CKV_HIGH_TIME + SKIP_CKV_LOW_TIME + 9) / 10;
+
+    ckv_rmt_build_pulse(SKIP_CKV_HIGH_TIME, SKIP_CKV_LOW_TIME);
+    gpio_set_level(lcd.config.bus.stv, 0);
+    start_ckv_cycles(lcd.first_line);
+    esp_rom_delay_us(period_us);
+    gpio_set_level(lcd.config.bus.stv, 1);
+    // wait for the remaining pulses, the RMT stops after the loop count
+    esp_rom_delay_us((lcd.first_line - 1) * period_us + 1);
+
+    ckv_rmt_build_signal();
+}
+
 void IRAM_ATTR epd_lcd_start_frame() {
-    int initial_lines = min(LINE_BATCH, lcd.display_lines);
+    int initial_lines = min(LINE_BATCH, lcd.frame_lines - lcd.first_line);
 
     // hsync: pulse with, back porch, active width, front porch
     int end_line
@@ -672,6 +718,13 @@ void IRAM_ATTR epd_lcd_start_frame() {
     fill_bounce_buffer(lcd.bounce_buffer[0]);
     fill_bounce_buffer(lcd.bounce_buffer[1]);
 
+    // the start pulse is shifted in while skipping, the following pulses
+    // then select the lines from `first_line` onwards.
+    bool skipped = lcd.first_line > 0;
+    if (skipped) {
+        skip_first_lines();
+    }
+
     // the start of DMA should be prior to the start of LCD engine
     gdma_start(lcd.dma_chan, (intptr_t)&lcd.dma_nodes[0]);
 
@@ -680,7 +733,9 @@ void IRAM_ATTR epd_lcd_start_frame() {
 
     // delay 1us is sufficient for DMA to pass data to LCD FIFO
     // in fact, this is only needed when LCD pixel clock is set too high
-    gpio_set_level(lcd.config.bus.stv, 0);
+    if (!skipped) {
+        gpio_set_level(lcd.config.bus.stv, 0);
+    }
     // esp_rom_delay_us(1);
     //  for picture clarity, it seems to be important to start CKV at a "good"
     //  time, seemingly start or towards end of line.
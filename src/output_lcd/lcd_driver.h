@@ -44,6 +44,18 @@ void epd_lcd_deinit();
 void epd_lcd_frame_done_cb(frame_done_func_t, void* payload);
 void epd_lcd_line_source_cb(line_cb_func_t, void* payload);
 void epd_lcd_start_frame();
+/**
+ * Set the lines driven per frame, from `first_line` up to `end_line`.
+ * Frames end after these lines, so the remaining lines are not scanned.
+ * Both are rounded to a multiple of the bounce buffer size
+ * and limited to the display height.
+ *
+ * The lines above `first_line` are skipped with short gate-only CKV pulses before
+ * the LCD output starts, like the fast gate clock pulses of the I2S output.
+ * The source driver keeps outputting the line it latched last in the meantime,
+ * so the previous frame must have ended with a no-op line.
+ */
+void epd_lcd_set_frame_lines(int first_line, int end_line);
 /**
  * Set the LCD pixel clock frequency in MHz.
  */
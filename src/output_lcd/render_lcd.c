@@ -6,12 +6,15 @@
 #ifdef RENDER_METHOD_LCD
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <rom/cache.h>
+#include <xtensa/core-macros.h>
 
 #include "../epd_internals.h"
 #include "../output_common/line_queue.h"
 #include "../output_common/lut.h"
 #include "../output_common/render_context.h"
+#include "../output_common/trace.h"
 #include "epd_board.h"
 #include "epdiy.h"
 #include "lcd_driver.h"
@@ -25,22 +28,50 @@ retrieve_line_isr(RenderContext_t* ctx, uint8_t* buf) {
     if (ctx->lines_consumed >= ctx->lines_total) {
         return false;
     }
+    uint32_t start_cycles = XTHAL_GET_CCOUNT();
+    uint32_t trace_start = epd_trace_begin();
     int thread = ctx->line_threads[ctx->lines_consumed];
-    assert(thread < NUM_RENDER_THREADS);
+    assert(thread < ctx->num_feed_tasks);
 
     LineQueue_t* lq = &ctx->line_queues[thread];
 
     BaseType_t awoken = pdFALSE;
 
-    if (lq_read(lq, buf) != 0) {
+    // The LCD output is not zero-copy: the line is copied from the queue slot
+    // into the driver's bounce buffer. Peeking only saves the intermediate
+    // copy through a line buffer, see `lq_peek()`.
+    const uint8_t* line = lq_peek(lq);
+    epd_stats_output_line(ctx, lq, line == NULL);
+    if (line == NULL) {
         ctx->error |= EPD_DRAW_EMPTY_LINE_QUEUE;
         memset(buf, 0x00, ctx->display_width / 4);
+    } else {
+        if (ctx->lines_consumed >= ctx->display_height) {
+            memset(buf, 0x00, ctx->display_width / 4);
+        } else {
+            memcpy(buf, line, ctx->display_width / 4);
+        }
+        lq_release(lq);
     }
+    ctx->lines_consumed += 1;
 
-    if (ctx->lines_consumed >= ctx->display_height) {
-        memset(buf, 0x00, ctx->display_width / 4);
+    if (epd_feed_needs_wake(ctx, thread)) {
+        xSemaphoreGiveFromISR(ctx->queue_space_smphr[thread], &awoken);
     }
-    ctx->lines_consumed += 1;
+    // wake up all waiting feed tasks on errors, so they can abort the frame
+    if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
+        for (int i = 0; i < ctx->num_feed_tasks; i++) {
+            if (atomic_exchange(&ctx->feed_waiting[i], false)) {
+                xSemaphoreGiveFromISR(ctx->queue_space_smphr[i], &awoken);
+            }
+        }
+    }
+
+    EpdFrameStats* stats = epd_frame_stats(ctx, ctx->current_frame);
+    if (stats != NULL) {
+        stats->output_cycles += XTHAL_GET_CCOUNT() - start_cycles;
+    }
+    epd_trace_end(EPD_TRACE_LINE_OUTPUT, EPD_TRACE_TRACK_ISR, ctx->lines_consumed - 1, trace_start);
     return awoken;
 }
 
@@ -49,6 +80,7 @@ static void IRAM_ATTR handle_lcd_frame_done(RenderContext_t* ctx) {
     epd_lcd_frame_done_cb(NULL, NULL);
     epd_lcd_line_source_cb(NULL, NULL);
 
+    epd_trace_instant(EPD_TRACE_FRAME_DONE, EPD_TRACE_TRACK_ISR, ctx->current_frame);
     BaseType_t task_awoken = pdFALSE;
     xSemaphoreGiveFromISR(ctx->frame_done, &task_awoken);
 
@@ -59,21 +91,30 @@ void lcd_do_update(RenderContext_t* ctx) {
     epd_set_mode(1);
 
     for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
+        if (!epd_frame_is_active(ctx, k)) {
+            ctx->current_frame++;
+            continue;
+        }
         epd_lcd_frame_done_cb((frame_done_func_t)handle_lcd_frame_done, ctx);
         prepare_context_for_next_frame(ctx);
+        epd_lcd_set_frame_lines(ctx->lines_first, ctx->lines_total);
 
-        // start both feeder tasks
-        xTaskNotifyGive(ctx->feed_tasks[!xPortGetCoreID()]);
-        xTaskNotifyGive(ctx->feed_tasks[xPortGetCoreID()]);
+        int64_t start_us = esp_timer_get_time();
+        uint32_t trace_start = epd_trace_begin();
+        epd_start_feed_tasks(ctx);
 
         // transmission is started in renderer threads, now wait util it's done
         xSemaphoreTake(ctx->frame_done, portMAX_DELAY);
 
-        for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+        for (int i = 0; i < ctx->num_feed_tasks; i++) {
             xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
         }
+        epd_stats_frame_done(ctx, start_us);
+        epd_trace_end(EPD_TRACE_FRAME, EPD_TRACE_TRACK_UPDATE, ctx->current_frame, trace_start);
 
         ctx->current_frame++;
+        // the frame ended with a no-op line, so the next ones can skip the lines above the drawn
+        ctx->lines_first = ctx->lines_skippable;
 
         // make the watchdog happy.
         vTaskDelay(0);
@@ -81,6 +122,7 @@ void lcd_do_update(RenderContext_t* ctx) {
 
     epd_lcd_line_source_cb(NULL, NULL);
     epd_lcd_frame_done_cb(NULL, NULL);
+    epd_lcd_set_frame_lines(0, ctx->display_height);
 
     epd_set_mode(0);
 }
@@ -184,63 +226,79 @@ lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
 
     assert(area.width == ctx->display_width && area.x == 0 && !ctx->error);
 
-    // index of the line that triggers the frame output when processed
-    int trigger_line = int_min(63, max_y - min_y);
+    // index of the line that triggers the frame output when processed.
+    // Lines between the first output line and the drawn area are queued as well,
+    // so count from the first output line.
+    // With few workers, the queues must not fill up before the trigger line is taken.
+    int queued_lines = ctx->num_feed_tasks * lq->size;
+    int output_lines = ctx->lines_total - ctx->lines_first;
+    int trigger_line = ctx->lines_first + int_min(int_min(63, queued_lines - 1), output_lines - 1);
 
-    while (l = atomic_fetch_add(&ctx->lines_prepared, 1), l < ctx->lines_total) {
+    int driven = 0, skipped = 0;
+    while ((l = epd_next_feed_line(ctx, thread_id)) >= 0) {
         ctx->line_threads[l] = thread_id;
 
         // queue is sufficiently filled to fill both bounce buffers, frame
         // can begin
-        if (l - min_y == trigger_line) {
+        if (l == trigger_line) {
             epd_lcd_line_source_cb((line_cb_func_t)&retrieve_line_isr, ctx);
             epd_lcd_start_frame();
         }
 
-        if (l < min_y || l >= max_y
-            || (ctx->drawn_lines != NULL && !ctx->drawn_lines[l - area.y])) {
-            uint8_t* buf = NULL;
-            while (buf == NULL) {
-                // break in case of errors
-                if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
-                    printf("on err 1: %d %d\n", ctx->lines_prepared, ctx->lines_consumed);
-                    lq_reset(lq);
-                    return;
-                };
-
-                buf = lq_current(lq);
+        if (l < min_y || l >= max_y || epd_line_is_skipped(ctx, l)) {
+            uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
+            // break in case of errors
+            if (buf == NULL) {
+                printf("on err 1: %d %d\n", ctx->lines_prepared, ctx->lines_consumed);
+                lq_reset(lq);
+                return;
             }
             memset(buf, 0x00, lq->element_size);
             lq_commit(lq);
+            skipped++;
             continue;
         }
 
-        uint32_t* lp = (uint32_t*)input_line;
+        const uint32_t* lp = (uint32_t*)input_line;
         const uint8_t* ptr = ptr_start + bytes_per_line * (l - min_y);
 
-        Cache_Start_DCache_Preload((uint32_t)ptr, ctx->display_width, 0);
+        Cache_Start_DCache_Preload((uint32_t)ptr, bytes_per_line, 0);
 
-        lp = (uint32_t*)ptr;
-
-        uint8_t* buf = NULL;
-        while (buf == NULL) {
-            // break in case of errors
-            if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
-                lq_reset(lq);
-                printf("on err 2: %d %d\n", ctx->lines_prepared, ctx->lines_consumed);
-                return;
-            };
+        if (ctx->from_ptr != NULL) {
+            const uint8_t* from = ctx->from_ptr + (ptr - ctx->data_ptr);
+            // the interlace reads the previous framebuffer line as well,
+            // there is only one preload in flight at a time
+            while (!Cache_DCache_Preload_Done()) {
+            }
+            Cache_Start_DCache_Preload((uint32_t)from, bytes_per_line, 0);
+            lp = epd_interlace_feed_line(ctx, thread_id, ptr, from);
+        } else {
+            lp = (uint32_t*)ptr;
+        }
 
-            buf = lq_current(lq);
+        uint8_t* buf = epd_wait_for_queue_space(ctx, thread_id);
+        // break in case of errors
+        if (buf == NULL) {
+            lq_reset(lq);
+            printf("on err 2: %d %d\n", ctx->lines_prepared, ctx->lines_consumed);
+            return;
         }
 
-        ctx->lut_lookup_func(lp, buf, ctx->conversion_lut, ctx->display_width);
+        epd_lookup_line(ctx, lp, buf);
 
-        // apply the line mask
-        epd_apply_line_mask_VE(buf, ctx->line_mask, ctx->display_width / 4);
+        // apply the line mask within the looked up span
+        epd_apply_line_mask_VE(
+            buf + ctx->span_x / 4, ctx->line_mask + ctx->span_x / 4, ctx->span_width / 4
+        );
 
         lq_commit(lq);
+        driven++;
     }
+
+    epd_stats_feed_lines(ctx, driven, skipped);
+
+    // all lines of this frame are taken, prepare the next one
+    epd_build_next_lut(ctx, thread_id);
 }
 
 #endif
@@ -22,8 +22,14 @@
 #include "output_common/lut.h"
 #include "output_common/render_context.h"
 #include "output_common/render_method.h"
+#include "output_common/trace.h"
+#ifdef RENDER_METHOD_I2S
 #include "output_i2s/render_i2s.h"
+#elif defined(RENDER_METHOD_LCD)
 #include "output_lcd/render_lcd.h"
+#elif defined(RENDER_METHOD_HOST)
+#include "output_host/render_host.h"
+#endif
 
 static inline int min(int x, int y) {
     return x < y ? x : y;
@@ -34,6 +40,12 @@ static inline int max(int x, int y) {
 
 const int clear_cycle_time = 12;
 
+/// Memory used for cached LUTs with `EPD_LUT_CACHE`.
+#define LUT_CACHE_BUDGET (1 << 20)
+
+/// Tile columns supported by `epd_difference_image_tiles()`, for up to 4096 pixels.
+#define MAX_DAMAGE_TILES_X 128
+
 #define RTOS_ERROR_CHECK(x)       \
     do {                          \
         esp_err_t __err_rc = (x); \
@@ -48,6 +60,8 @@ void epd_push_pixels(EpdRect area, short time, int color) {
     render_context.area = area;
 #ifdef RENDER_METHOD_LCD
     epd_push_pixels_lcd(&render_context, time, color);
+#elif defined(RENDER_METHOD_HOST)
+    epd_push_pixels_host(&render_context, time, color);
 #else
     epd_push_pixels_i2s(&render_context, area, time, color);
 #endif
@@ -88,10 +102,137 @@ static inline int rounded_display_height() {
     return (((epd_height() + 7) / 8) * 8);
 }
 
+/**
+ * Number of lines to drive per frame: Frames end after the last line that is drawn,
+ * followed by at least one no-op line, so the time per frame scales
+ * with the vertical extent of the update instead of the display height.
+ */
+static int frame_line_count(RenderContext_t* ctx) {
+    int min_y, max_y, bytes_per_line, pixels_per_byte;
+    const uint8_t* start_ptr;
+    get_buffer_params(ctx, &bytes_per_line, &start_ptr, &min_y, &max_y, &pixels_per_byte);
+
+    max_y = min(max_y, ctx->display_height);
+    if (ctx->drawn_lines != NULL) {
+        while (max_y > min_y && max_y > 0 && !ctx->drawn_lines[max_y - 1 - ctx->area.y]) {
+            max_y--;
+        }
+    }
+
+#ifdef RENDER_METHOD_LCD
+    // the LCD driver outputs no-ops for lines beyond the display
+    // and needs a multiple of the bounce buffer size
+    return min(((max_y + 1 + 7) / 8) * 8, rounded_display_height());
+#else
+    return min(max_y + 1, ctx->display_height);
+#endif
+}
+
+/**
+ * First line of the drawn lines, rounded down to a multiple of 8.
+ * On the LCD and host outputs, frames after the first of an update start at this line
+ * and skip the lines above it with gate-only clock pulses.
+ */
+static int frame_skippable_lines(RenderContext_t* ctx) {
+    int min_y, max_y, bytes_per_line, pixels_per_byte;
+    const uint8_t* start_ptr;
+    get_buffer_params(ctx, &bytes_per_line, &start_ptr, &min_y, &max_y, &pixels_per_byte);
+
+    min_y = max(min_y, 0);
+    max_y = min(max_y, ctx->display_height);
+    if (ctx->drawn_lines != NULL) {
+        while (min_y < max_y && !ctx->drawn_lines[min_y - ctx->area.y]) {
+            min_y++;
+        }
+    }
+    return min(min_y, ctx->lines_total - 1) / 8 * 8;
+}
+
+/**
+ * Mark the frames of `phases` in which at least one of `transitions` drives a pixel
+ * in `active_frames`.
+ * Returns the number of frames up to and including the last active frame.
+ */
+static int find_active_frames(
+    const EpdWaveformPhases* phases, const EpdTransitions* transitions, uint32_t* active_frames
+) {
+    int frame_count = 0;
+    for (int frame = 0; frame < phases->phases; frame++) {
+        const uint8_t* p_lut = phases->luts + (16 * 4 * frame);
+        bool active = false;
+        for (int to = 0; to < 16 && !active; to++) {
+            uint16_t from_set = transitions->to_from[to];
+            for (int from = 0; from < 16; from++) {
+                if (!(from_set & (1 << from))) {
+                    continue;
+                }
+                uint8_t action = (p_lut[(to << 2) + (from >> 2)] >> (6 - 2 * (from & 3))) & 3;
+                if (action != 0) {
+                    active = true;
+                    break;
+                }
+            }
+        }
+
+        if (active) {
+            active_frames[frame / 32] |= 1u << (frame % 32);
+            frame_count = frame + 1;
+        } else {
+            active_frames[frame / 32] &= ~(1u << (frame % 32));
+        }
+    }
+    return frame_count;
+}
+
+/**
+ * Determine for each line of the update the number of frames until the last frame
+ * which drives any of the line's transitions.
+ */
+static void find_line_frames(
+    const EpdWaveformPhases* phases,
+    const EpdTransitions* line_transitions,
+    const bool* drawn_lines,
+    EpdRect area,
+    uint8_t* line_frames,
+    int lines
+) {
+    // number of frames until a transition is finished, indexed by (to << 4) | from
+    uint8_t transition_frames[256] = { 0 };
+    for (int frame = 0; frame < phases->phases; frame++) {
+        const uint8_t* p_lut = phases->luts + (16 * 4 * frame);
+        for (int to = 0; to < 16; to++) {
+            for (int from = 0; from < 16; from++) {
+                uint8_t action = (p_lut[(to << 2) + (from >> 2)] >> (6 - 2 * (from & 3))) & 3;
+                if (action != 0) {
+                    transition_frames[(to << 4) | from] = frame + 1;
+                }
+            }
+        }
+    }
+
+    for (int l = 0; l < lines; l++) {
+        int line = l - area.y;
+        if (line < 0 || line >= area.height || (drawn_lines != NULL && !drawn_lines[line])) {
+            line_frames[l] = 0;
+            continue;
+        }
+        uint8_t frames = 0;
+        for (int to = 0; to < 16; to++) {
+            uint16_t from_set = line_transitions[line].to_from[to];
+            for (int from = 0; from < 16 && from_set; from++, from_set >>= 1) {
+                if (from_set & 1) {
+                    frames = max(frames, transition_frames[(to << 4) | from]);
+                }
+            }
+        }
+        line_frames[l] = frames;
+    }
+}
+
 // FIXME: fix misleading naming:
 //  area -> buffer dimensions
 //  crop -> area taken out of buffer
-enum EpdDrawError IRAM_ATTR epd_draw_base(
+enum EpdDrawError IRAM_ATTR epd_draw_base_with_options(
     EpdRect area,
     const uint8_t* data,
     EpdRect crop_to,
@@ -99,8 +240,10 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
     int temperature,
     const bool* drawn_lines,
     const uint8_t* drawn_columns,
-    const EpdWaveform* waveform
+    const EpdWaveform* waveform,
+    const EpdDrawOptions* options
 ) {
+    const uint8_t* from = options != NULL ? options->from : NULL;
     if (waveform == NULL) {
         return EPD_DRAW_NO_PHASES_AVAILABLE;
     }
@@ -137,8 +280,32 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
         return EPD_DRAW_INVALID_CROP;
     }
 
+    // the lookup functions work on the interlaced difference,
+    // while the input data is read as 4bpp framebuffers.
+    enum EpdDrawMode lookup_mode = mode;
+    const int previous_mask = PREVIOUSLY_WHITE | PREVIOUSLY_BLACK;
+    if (from != NULL && (mode & MODE_PACKING_4PPB)) {
+        if (area.x != 0 || area.width != render_context.display_width) {
+            return EPD_DRAW_INVALID_CROP;
+        }
+        // 2bpp lines are interleaved and looked up as they are
+        lookup_mode = mode & ~previous_mask;
+    } else if (from != NULL) {
+        if (area.x != 0 || area.width != render_context.display_width) {
+            return EPD_DRAW_INVALID_CROP;
+        }
+        const int packing_mask
+            = MODE_PACKING_8PPB | MODE_PACKING_2PPB | MODE_PACKING_1PPB_DIFFERENCE;
+        mode = (mode & ~packing_mask) | MODE_PACKING_2PPB;
+        lookup_mode = (mode & ~packing_mask) | MODE_PACKING_1PPB_DIFFERENCE;
+    } else if ((mode & MODE_PACKING_4PPB) && !(mode & previous_mask)) {
+        // without a previous buffer, the previous color must be known
+        return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+    }
+
 #ifdef RENDER_METHOD_LCD
-    if (mode & MODE_PACKING_1PPB_DIFFERENCE && render_context.conversion_lut_size > 1 << 10) {
+    if (lookup_mode & MODE_PACKING_1PPB_DIFFERENCE
+        && render_context.conversion_lut_size > 1 << 10) {
         ESP_LOGI(
             "epdiy",
             "Using optimized vector implementation on the ESP32-S3, only 1k of %d LUT in use!",
@@ -147,7 +314,8 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
     }
 #endif
 
-    LutFunctionPair lut_functions = find_lut_functions(mode, render_context.conversion_lut_size);
+    LutFunctionPair lut_functions
+        = find_lut_functions(lookup_mode, render_context.conversion_lut_size);
     if (lut_functions.build_func == NULL || lut_functions.lookup_func == NULL) {
         ESP_LOGE("epdiy", "no output lookup method found for your mode and LUT size!");
         return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
@@ -162,14 +330,42 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
     render_context.error = EPD_DRAW_SUCCESS;
     render_context.drawn_lines = drawn_lines;
     render_context.data_ptr = data;
+    render_context.from_ptr = from;
     render_context.lut_build_func = lut_functions.build_func;
     render_context.lut_lookup_func = lut_functions.lookup_func;
+    render_context.lut_build_size = lut_functions.lut_size;
 
     render_context.lines_prepared = 0;
     render_context.lines_consumed = 0;
-    render_context.lines_total = rounded_display_height();
+    render_context.lines_total = frame_line_count(&render_context);
+    render_context.lines_first = 0;
+    render_context.lines_skippable = frame_skippable_lines(&render_context);
     render_context.current_frame = 0;
+    render_context.next_lut_frame = -1;
+
+    // skip frames which do not drive any of the transitions present,
+    // all frames of longer waveforms are drawn
+    memset(render_context.active_frames, 0xFF, sizeof(render_context.active_frames));
+    if (options != NULL && options->transitions != NULL && waveform_phases != NULL
+        && waveform_phases->phases <= MAX_ACTIVE_FRAMES) {
+        frame_count = find_active_frames(
+            waveform_phases, options->transitions, render_context.active_frames
+        );
+    }
     render_context.cycle_frames = frame_count;
+
+    // lines are skipped once the last frame driving one of their transitions has passed
+    memset(render_context.line_frames, 0xFF, rounded_display_height());
+    if (options != NULL && options->line_transitions != NULL && waveform_phases != NULL) {
+        find_line_frames(
+            waveform_phases,
+            options->line_transitions,
+            drawn_lines,
+            area,
+            render_context.line_frames,
+            render_context.lines_total
+        );
+    }
     render_context.phase_times = NULL;
     if (waveform_phases != NULL && waveform_phases->phase_times != NULL) {
         render_context.phase_times = waveform_phases->phase_times;
@@ -179,11 +375,38 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
         render_context.line_mask, drawn_columns, render_context.display_width / 4
     );
 
+    // only the dirty columns are looked up
+    epd_find_column_span(
+        drawn_columns,
+        render_context.display_width,
+        &render_context.span_x,
+        &render_context.span_width
+    );
+    // pixels per byte of the lines passed to the lookup function
+    int lookup_pixels_per_byte = 1;
+    if (lookup_mode & MODE_PACKING_2PPB) {
+        lookup_pixels_per_byte = 2;
+    } else if (lookup_mode & MODE_PACKING_4PPB) {
+        // interleaved lines of both buffers take two bytes per four pixels
+        lookup_pixels_per_byte = from != NULL ? 2 : 4;
+    } else if (lookup_mode & MODE_PACKING_8PPB) {
+        lookup_pixels_per_byte = 8;
+    }
+    render_context.span_input_offset = render_context.span_x / lookup_pixels_per_byte;
+
+    uint32_t trace_start = epd_trace_begin();
+    epd_stats_begin(&render_context);
 #ifdef RENDER_METHOD_I2S
     i2s_do_update(&render_context);
 #elif defined(RENDER_METHOD_LCD)
     lcd_do_update(&render_context);
+#elif defined(RENDER_METHOD_HOST)
+    host_do_update(&render_context);
 #endif
+    epd_stats_end(&render_context);
+    epd_trace_end(
+        EPD_TRACE_UPDATE, EPD_TRACE_TRACK_UPDATE, render_context.stats.frames, trace_start
+    );
 
     if (render_context.error & EPD_DRAW_EMPTY_LINE_QUEUE) {
         ESP_LOGE("epdiy", "line buffer underrun occurred!");
@@ -195,22 +418,70 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
     return EPD_DRAW_SUCCESS;
 }
 
+enum EpdDrawError epd_draw_base(
+    EpdRect area,
+    const uint8_t* data,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform
+) {
+    return epd_draw_base_with_options(
+        area, data, crop_to, mode, temperature, drawn_lines, drawn_columns, waveform, NULL
+    );
+}
+
+enum EpdDrawError epd_draw_difference(
+    EpdRect area,
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform
+) {
+    assert(to != NULL && from != NULL);
+    // both framebuffers must have the same alignment for vectorized interlacing
+    assert((uintptr_t)to % 16 == (uintptr_t)from % 16);
+    EpdDrawOptions options = { .from = from, .transitions = NULL, .line_transitions = NULL };
+    return epd_draw_base_with_options(
+        area, to, crop_to, mode, temperature, drawn_lines, drawn_columns, waveform, &options
+    );
+}
+
+const EpdRenderStats* epd_get_render_stats() {
+    return &render_context.stats;
+}
+
 static void IRAM_ATTR render_thread(void* arg) {
-    int thread_id = (int)arg;
+    int thread_id = (intptr_t)arg;
 
     while (true) {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start_us = esp_timer_get_time();
+        uint32_t trace_start = epd_trace_begin();
 
 #ifdef RENDER_METHOD_LCD
         lcd_calculate_frame(&render_context, thread_id);
+#elif defined(RENDER_METHOD_HOST)
+        host_calculate_frame(&render_context, thread_id);
 #elif defined(RENDER_METHOD_I2S)
-        if (thread_id == 0) {
+        // the last task outputs the lines fetched by the others
+        if (thread_id < render_context.num_feed_tasks - 1) {
             i2s_fetch_frame_data(&render_context, thread_id);
         } else {
             i2s_output_frame(&render_context, thread_id);
         }
 #endif
 
+        render_context.stats.feed_us[thread_id] += esp_timer_get_time() - start_us;
+        epd_trace_end(
+            EPD_TRACE_FEED_FRAME, thread_id, render_context.current_frame, trace_start
+        );
         xSemaphoreGive(render_context.feed_done_smphr[thread_id]);
     }
 }
@@ -252,7 +523,7 @@ void epd_renderer_init(enum EpdInitOptions options) {
         lut_size = 1 << 10;
     } else if (options & EPD_LUT_64K) {
         lut_size = 1 << 16;
-    } else if (options == EPD_OPTIONS_DEFAULT) {
+    } else if (!(options & (EPD_LUT_1K | EPD_LUT_64K))) {
 #ifdef RENDER_METHOD_LCD
         lut_size = 1 << 10;
 #else
@@ -263,7 +534,7 @@ void epd_renderer_init(enum EpdInitOptions options) {
         return;
     }
 
-    ESP_LOGI("epd", "Space used for waveform LUT: %dK", lut_size / 1024);
+    ESP_LOGI("epd", "Space used for waveform LUT: %dK", (int)(lut_size / 1024));
     render_context.conversion_lut
         = (uint8_t*)heap_caps_malloc(lut_size, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
     if (render_context.conversion_lut == NULL) {
@@ -273,10 +544,47 @@ void epd_renderer_init(enum EpdInitOptions options) {
     render_context.conversion_lut_size = lut_size;
     render_context.static_line_buffer = NULL;
 
+    // Small LUTs are double-buffered, so the next frame's LUT can be built
+    // while the current frame is output.
+    render_context.next_conversion_lut = NULL;
+    render_context.next_lut_frame = -1;
+    if (lut_size <= 1 << 10) {
+        render_context.next_conversion_lut
+            = (uint8_t*)heap_caps_malloc(lut_size, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        if (render_context.next_conversion_lut == NULL) {
+            ESP_LOGW("epd", "could not allocate second LUT, building LUTs between frames.");
+        }
+    }
+
+    render_context.lut_cache = NULL;
+    if (options & EPD_LUT_CACHE) {
+        static LutCache_t lut_cache;
+        if (lut_cache_init(&lut_cache, lut_size, LUT_CACHE_BUDGET)) {
+            render_context.lut_cache = &lut_cache;
+            ESP_LOGI("epd", "LUT cache with %d entries enabled", lut_cache.num_entries);
+        } else {
+            ESP_LOGW("epd", "could not allocate LUT cache, continuing without.");
+        }
+    }
+
+    int num_tasks = (options & EPD_RENDER_WORKERS_MASK) >> 8;
+    if (num_tasks == 0) {
+        num_tasks = 2;
+    }
+#ifdef RENDER_METHOD_I2S
+    if (num_tasks < 2) {
+        ESP_LOGW("epd", "the I2S render method needs at least 2 render workers, using 2.");
+        num_tasks = 2;
+    }
+#endif
+    render_context.num_feed_tasks = num_tasks;
+
     render_context.frame_done = xSemaphoreCreateBinary();
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+    for (int i = 0; i < render_context.num_feed_tasks; i++) {
         render_context.feed_done_smphr[i] = xSemaphoreCreateBinary();
+        render_context.queue_space_smphr[i] = xSemaphoreCreateBinary();
+        atomic_init(&render_context.feed_waiting[i], false);
     }
 
     // When using the LCD peripheral, we may need padding lines to
@@ -284,6 +592,10 @@ void epd_renderer_init(enum EpdInitOptions options) {
     render_context.line_threads = (uint8_t*)heap_caps_malloc(
         rounded_display_height(), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
     );
+    render_context.line_frames = (uint8_t*)heap_caps_malloc(
+        rounded_display_height(), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
+    );
+    assert(render_context.line_frames != NULL);
 
     int queue_len = 32;
     if (options & EPD_FEED_QUEUE_32) {
@@ -291,6 +603,8 @@ void epd_renderer_init(enum EpdInitOptions options) {
     } else if (options & EPD_FEED_QUEUE_8) {
         queue_len = 8;
     }
+    // claim lines in chunks which evenly divide the queue, to reduce contention
+    render_context.line_chunk = queue_len / 4;
 
     if (render_context.conversion_lut == NULL) {
         ESP_LOGE("epd", "could not allocate line mask!");
@@ -301,26 +615,42 @@ void epd_renderer_init(enum EpdInitOptions options) {
         = heap_caps_aligned_alloc(16, epd_width() / 4, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
     assert(render_context.line_mask != NULL);
 
-#ifdef RENDER_METHOD_LCD
+#if defined(RENDER_METHOD_LCD) || defined(RENDER_METHOD_HOST)
     size_t queue_elem_size = render_context.display_width / 4;
 #elif defined(RENDER_METHOD_I2S)
     size_t queue_elem_size = render_context.display_width;
 #endif
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+    for (int i = 0; i < render_context.num_feed_tasks; i++) {
         render_context.line_queues[i] = lq_init(queue_len, queue_elem_size);
-        render_context.feed_line_buffers[i] = (uint8_t*)heap_caps_malloc(
-            render_context.display_width, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
+        // padding allows shifting the buffer start to match framebuffer alignment
+        // when interlacing differences on the fly.
+        render_context.feed_line_buffers[i] = (uint8_t*)heap_caps_aligned_alloc(
+            16, render_context.display_width + 32, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
         );
         assert(render_context.feed_line_buffers[i] != NULL);
+        render_context.feed_col_dirtyness[i] = (uint8_t*)heap_caps_aligned_alloc(
+            16, render_context.display_width / 2 + 16, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
+        );
+        assert(render_context.feed_col_dirtyness[i] != NULL);
+
+        BaseType_t core = i % portNUM_PROCESSORS;
+        if ((options & EPD_RENDER_NO_AFFINITY) == EPD_RENDER_NO_AFFINITY) {
+            core = tskNO_AFFINITY;
+        } else if (options & EPD_RENDER_CORE_0) {
+            core = 0;
+        } else if (options & EPD_RENDER_CORE_1) {
+            core = 1;
+        }
+        render_context.feed_task_cores[i] = core;
         RTOS_ERROR_CHECK(xTaskCreatePinnedToCore(
             render_thread,
             "epd_prep",
             1 << 12,
-            (void*)i,
+            (void*)(intptr_t)i,
             configMAX_PRIORITIES - 1,
             &render_context.feed_tasks[i],
-            i
+            core
         ));
     }
 }
@@ -330,15 +660,19 @@ void epd_renderer_deinit() {
 
     epd_board->poweroff(epd_ctrl_state());
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+    for (int i = 0; i < render_context.num_feed_tasks; i++) {
         vTaskDelete(render_context.feed_tasks[i]);
         lq_free(&render_context.line_queues[i]);
         heap_caps_free(render_context.feed_line_buffers[i]);
+        heap_caps_free(render_context.feed_col_dirtyness[i]);
         vSemaphoreDelete(render_context.feed_done_smphr[i]);
+        vSemaphoreDelete(render_context.queue_space_smphr[i]);
     }
 
 #ifdef RENDER_METHOD_I2S
     i2s_deinit();
+#elif defined(RENDER_METHOD_HOST)
+    host_deinit();
 #endif
 
     epd_control_reg_deinit();
@@ -347,8 +681,15 @@ void epd_renderer_deinit() {
         epd_board->deinit();
     }
 
+    if (render_context.lut_cache != NULL) {
+        lut_cache_free(render_context.lut_cache);
+        render_context.lut_cache = NULL;
+    }
     heap_caps_free(render_context.conversion_lut);
+    heap_caps_free(render_context.next_conversion_lut);
+    render_context.next_conversion_lut = NULL;
     heap_caps_free(render_context.line_threads);
+    heap_caps_free(render_context.line_frames);
     heap_caps_free(render_context.line_mask);
     vSemaphoreDelete(render_context.frame_done);
 }
@@ -363,14 +704,59 @@ uint32_t epd_interlace_4bpp_line_VE(
 );
 #endif
 
+/**
+ * Add the gray level transitions of the 8 pixels of the words `t` and `f`
+ * to `to_from`, as in `EpdTransitions`.
+ */
+__attribute__((optimize("O3"))) static inline void word_transitions(
+    uint32_t t, uint32_t f, uint16_t* to_from
+) {
+    // uniform words, e.g. of backgrounds, are a single transition
+    if (((t ^ (t >> 4)) & 0x0FFFFFFF) == 0 && ((f ^ (f >> 4)) & 0x0FFFFFFF) == 0) {
+        to_from[t & 0x0F] |= 1 << (f & 0x0F);
+        return;
+    }
+    for (int shift = 0; shift < 32; shift += 4) {
+        to_from[(t >> shift) & 0x0F] |= 1 << ((f >> shift) & 0x0F);
+    }
+}
+
+#ifdef RENDER_METHOD_LCD
+/**
+ * Add the transitions of `len` pixels of the lines at `to` and `from` to `to_from`,
+ * for the vector interlace, which does not collect them.
+ * Both buffers must be 32 bit aligned.
+ */
+__attribute__((optimize("O3"))) static void segment_transitions(
+    const uint8_t* to, const uint8_t* from, int len, uint16_t* to_from
+) {
+    const uint32_t* t = (const uint32_t*)to;
+    const uint32_t* f = (const uint32_t*)from;
+    for (int i = 0; i < len / 8; i++) {
+        word_transitions(t[i], f[i], to_from);
+    }
+    for (int x = len / 8 * 8; x < len; x++) {
+        uint8_t tv = (to[x / 2] >> (4 * (x % 2))) & 0x0F;
+        uint8_t fv = (from[x / 2] >> (4 * (x % 2))) & 0x0F;
+        to_from[tv] |= 1 << fv;
+    }
+}
+#endif
+
 /**
  * Interlaces `len` nibbles from the buffers `to` and `from` into `interlaced`.
- * In the process, tracks which nibbles differ in `col_dirtyness`.
+ * In the process, tracks which nibbles differ in `col_dirtyness`
+ * and, if `to_from` is not NULL, adds the transitions of all pixels to it.
  * Returns `1` if there are differences, `0` otherwise.
  * Does not require special alignment of the buffers beyond 32 bit alignment.
  */
 __attribute__((optimize("O3"))) static inline int _interlace_line_unaligned(
-    const uint8_t* to, const uint8_t* from, uint8_t* interlaced, uint8_t* col_dirtyness, int len
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int len,
+    uint16_t* to_from
 ) {
     int dirty = 0;
     for (int x = 0; x < len; x++) {
@@ -381,23 +767,120 @@ __attribute__((optimize("O3"))) static inline int _interlace_line_unaligned(
         col_dirtyness[x / 2] |= (t ^ f) << (4 * (x % 2));
         dirty |= (t ^ f);
         interlaced[x] = (t << 4) | f;
+        if (to_from != NULL) {
+            to_from[t] |= 1 << f;
+        }
     }
     return dirty;
 }
 
+#if defined(RENDER_METHOD_I2S) || defined(RENDER_METHOD_HOST)
+/// Spread the lower 16 bits of `x` to the even bytes of the result.
+static inline uint32_t spread_bytes(uint32_t x) {
+    x &= 0xFFFF;
+    return (x | (x << 8)) & 0x00FF00FF;
+}
+
+/**
+ * Interlace the 8 pixels of the words `t` and `f` into `interlaced[0..1]`.
+ */
+__attribute__((optimize("O3"))) static inline void interlace_word(
+    uint32_t t, uint32_t f, uint32_t* interlaced
+) {
+    // even pixels in the lower, odd pixels in the upper nibble of each byte
+    uint32_t even = ((t & 0x0F0F0F0F) << 4) | (f & 0x0F0F0F0F);
+    uint32_t odd = (t & 0xF0F0F0F0) | ((f >> 4) & 0x0F0F0F0F);
+    interlaced[0] = spread_bytes(even) | (spread_bytes(odd) << 8);
+    interlaced[1] = spread_bytes(even >> 16) | (spread_bytes(odd >> 16) << 8);
+}
+
+/**
+ * Interlaces `len` nibbles from the buffers `to` and `from` into `interlaced`,
+ * 8 pixels at a time. Tracks differing nibbles in `col_dirtyness` and transitions
+ * in `to_from` like `_interlace_line_unaligned()`, but word-wise.
+ * Falls back to the nibble loop for buffers that are not 32 bit aligned.
+ * Returns `1` if there are differences, `0` otherwise.
+ */
+__attribute__((optimize("O3"))) static int _interlace_line_words(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int len,
+    uint16_t* to_from
+) {
+    if (((uintptr_t)to | (uintptr_t)from | (uintptr_t)interlaced | (uintptr_t)col_dirtyness) % 4) {
+        return _interlace_line_unaligned(to, from, interlaced, col_dirtyness, len, to_from);
+    }
+
+    const uint32_t* t = (const uint32_t*)to;
+    const uint32_t* f = (const uint32_t*)from;
+    uint32_t* out = (uint32_t*)interlaced;
+    uint32_t* c = (uint32_t*)col_dirtyness;
+    uint32_t dirty = 0;
+    int words = len / 8;
+    int i = 0;
+
+    // identical chunks of 16 bytes leave the dirtyness as it is
+    for (; i + 4 <= words; i += 4) {
+        uint32_t diff = (t[i] ^ f[i]) | (t[i + 1] ^ f[i + 1]) | (t[i + 2] ^ f[i + 2])
+                        | (t[i + 3] ^ f[i + 3]);
+        if (diff == 0) {
+            for (int j = i; j < i + 4; j++) {
+                interlace_word(t[j], t[j], out + 2 * j);
+                if (to_from != NULL) {
+                    word_transitions(t[j], t[j], to_from);
+                }
+            }
+            continue;
+        }
+        for (int j = i; j < i + 4; j++) {
+            c[j] |= t[j] ^ f[j];
+            interlace_word(t[j], f[j], out + 2 * j);
+            if (to_from != NULL) {
+                word_transitions(t[j], f[j], to_from);
+            }
+        }
+        dirty |= diff;
+    }
+    for (; i < words; i++) {
+        uint32_t diff = t[i] ^ f[i];
+        c[i] |= diff;
+        dirty |= diff;
+        interlace_word(t[i], f[i], out + 2 * i);
+        if (to_from != NULL) {
+            word_transitions(t[i], f[i], to_from);
+        }
+    }
+
+    int done = words * 8;
+    dirty |= _interlace_line_unaligned(
+        to + done / 2,
+        from + done / 2,
+        interlaced + done,
+        col_dirtyness + done / 2,
+        len - done,
+        to_from
+    );
+    return dirty != 0;
+}
+#endif
+
 /**
  * Interlaces the lines at `to`, `from` into `interlaced`.
+ * If `to_from` is not NULL, the transitions of all pixels are added to it.
  * returns `1` if there are differences, `0` otherwise.
  */
-__attribute__((optimize("O3"))) bool _epd_interlace_line(
+__attribute__((optimize("O3"))) static bool interlace_line(
     const uint8_t* to,
     const uint8_t* from,
     uint8_t* interlaced,
     uint8_t* col_dirtyness,
-    int fb_width
+    int fb_width,
+    uint16_t* to_from
 ) {
-#ifdef RENDER_METHOD_I2S
-    return _interlace_line_unaligned(to, from, interlaced, col_dirtyness, fb_width) > 0;
+#if defined(RENDER_METHOD_I2S) || defined(RENDER_METHOD_HOST)
+    return _interlace_line_words(to, from, interlaced, col_dirtyness, fb_width, to_from);
 #elif defined(RENDER_METHOD_LCD)
     // Use Vector Extensions with the ESP32-S3.
     // Both input buffers should have the same alignment w.r.t. 16 bytes,
@@ -405,12 +888,14 @@ __attribute__((optimize("O3"))) bool _epd_interlace_line(
     uint32_t dirty = 0;
 
     // alignment boundaries in pixels
-    int unaligned_len_front_px = ((16 - (uint32_t)to % 16) * 2) % 32;
-    int unaligned_len_back_px = (((uint32_t)to + fb_width / 2) % 16) * 2;
+    int unaligned_len_front_px = ((16 - (uintptr_t)to % 16) * 2) % 32;
+    int unaligned_len_back_px = (((uintptr_t)to + fb_width / 2) % 16) * 2;
     int unaligned_back_start_px = fb_width - unaligned_len_back_px;
     int aligned_len_px = fb_width - unaligned_len_front_px - unaligned_len_back_px;
 
-    dirty |= _interlace_line_unaligned(to, from, interlaced, col_dirtyness, unaligned_len_front_px);
+    dirty |= _interlace_line_unaligned(
+        to, from, interlaced, col_dirtyness, unaligned_len_front_px, to_from
+    );
     dirty |= epd_interlace_4bpp_line_VE(
         to + unaligned_len_front_px / 2,
         from + unaligned_len_front_px / 2,
@@ -418,50 +903,160 @@ __attribute__((optimize("O3"))) bool _epd_interlace_line(
         col_dirtyness + unaligned_len_front_px / 2,
         aligned_len_px
     );
+    // the vector kernel does not collect transitions,
+    // the lines it just loaded are still in the cache
+    if (to_from != NULL) {
+        segment_transitions(
+            to + unaligned_len_front_px / 2,
+            from + unaligned_len_front_px / 2,
+            aligned_len_px,
+            to_from
+        );
+    }
     dirty |= _interlace_line_unaligned(
         to + unaligned_back_start_px / 2,
         from + unaligned_back_start_px / 2,
         interlaced + unaligned_back_start_px,
         col_dirtyness + unaligned_back_start_px / 2,
-        unaligned_len_back_px
+        unaligned_len_back_px,
+        to_from
     );
     return dirty;
 #endif
 }
 
-EpdRect epd_difference_image_base(
+bool _epd_interlace_line(
     const uint8_t* to,
     const uint8_t* from,
-    EpdRect crop_to,
-    int fb_width,
-    int fb_height,
     uint8_t* interlaced,
-    bool* dirty_lines,
-    uint8_t* col_dirtyness
+    uint8_t* col_dirtyness,
+    int fb_width
 ) {
-    assert(fb_width % 8 == 0);
-    assert(col_dirtyness != NULL);
+    return interlace_line(to, from, interlaced, col_dirtyness, fb_width, NULL);
+}
 
-    // these buffers should be allocated 16 byte aligned
-    assert((uint32_t)to % 16 == 0);
-    assert((uint32_t)from % 16 == 0);
-    assert((uint32_t)col_dirtyness % 16 == 0);
-    assert((uint32_t)interlaced % 16 == 0);
+/**
+ * Compare `len` pixels of the lines at `to`, `from` and track the differing nibbles
+ * in `col_dirtyness`, without writing an interlaced line.
+ * If `to_from` is not NULL, the transitions of all pixels are added to it.
+ * All buffers must be 32 bit aligned and `len` must be divisible by 8.
+ * Returns `1` if there are differences, `0` otherwise.
+ */
+__attribute__((optimize("O3"))) static bool _compare_line(
+    const uint8_t* to, const uint8_t* from, uint8_t* col_dirtyness, int len, uint16_t* to_from
+) {
+    const uint32_t* t = (const uint32_t*)to;
+    const uint32_t* f = (const uint32_t*)from;
+    uint32_t* c = (uint32_t*)col_dirtyness;
+    uint32_t dirty = 0;
+    for (int i = 0; i < len / 8; i++) {
+        uint32_t diff = t[i] ^ f[i];
+        c[i] |= diff;
+        dirty |= diff;
+        if (to_from != NULL) {
+            word_transitions(t[i], f[i], to_from);
+        }
+    }
+    return dirty != 0;
+}
 
-    memset(col_dirtyness, 0, fb_width / 2);
-    memset(dirty_lines, 0, sizeof(bool) * fb_height);
+/**
+ * Whether `len` pixels of the lines at `to` and `from` are equal.
+ * Compares 16 bytes per iteration and returns at the first difference.
+ * Both buffers must be 32 bit aligned.
+ */
+__attribute__((optimize("O3"))) static bool _lines_equal(
+    const uint8_t* to, const uint8_t* from, int len
+) {
+    const uint32_t* t = (const uint32_t*)to;
+    const uint32_t* f = (const uint32_t*)from;
+    int words = len / 8;
+    int i = 0;
+    for (; i + 4 <= words; i += 4) {
+        if ((t[i] ^ f[i]) | (t[i + 1] ^ f[i + 1]) | (t[i + 2] ^ f[i + 2]) | (t[i + 3] ^ f[i + 3])) {
+            return false;
+        }
+    }
+    for (; i < words; i++) {
+        if (t[i] != f[i]) {
+            return false;
+        }
+    }
+    // an odd trailing pixel is compared with its neighbor nibble
+    int tail_bytes = (len - words * 8 + 1) / 2;
+    return memcmp(to + words * 4, from + words * 4, tail_bytes) == 0;
+}
 
-    int x_end = min(fb_width, crop_to.x + crop_to.width);
-    int y_end = min(fb_height, crop_to.y + crop_to.height);
+/**
+ * Interlace or, if `interlaced` is NULL, only compare a line segment.
+ * Unchanged segments are not written to `interlaced`.
+ * If `to_from` is not NULL, the transitions of the segment's pixels are added to it,
+ * except for unchanged segments when interlacing.
+ */
+static inline bool diff_line(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int len,
+    uint16_t* to_from
+) {
+    if (interlaced == NULL) {
+        return _compare_line(to, from, col_dirtyness, len, to_from);
+    }
+    // most lines of an update are usually unchanged, skip the write to the difference image
+    if (_lines_equal(to, from, len)) {
+        return false;
+    }
+    return interlace_line(to, from, interlaced, col_dirtyness, len, to_from);
+}
 
-    for (int y = crop_to.y; y < y_end; y++) {
-        uint32_t offset = y * fb_width / 2;
-        int dirty = _epd_interlace_line(
-            to + offset, from + offset, interlaced + offset * 2, col_dirtyness, fb_width
-        );
-        dirty_lines[y] = dirty;
+/**
+ * Store the transitions `to_from` of line `y` in `line_transitions`, if not NULL,
+ * and add them to `transitions`, if the line is dirty.
+ */
+/// Whether `tile` is set in a bitmap of tile columns.
+static inline bool tile_bit(const uint32_t* bits, int tile) {
+    return (bits[tile / 32] >> (tile % 32)) & 1;
+}
+
+/// Set or clear `tile` in a bitmap of tile columns.
+static inline void set_tile_bit(uint32_t* bits, int tile, bool value) {
+    if (value) {
+        bits[tile / 32] |= 1u << (tile % 32);
+    } else {
+        bits[tile / 32] &= ~(1u << (tile % 32));
     }
+}
 
+static inline void store_line_transitions(
+    const uint16_t* to_from,
+    int y,
+    bool dirty,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+) {
+    if (line_transitions != NULL) {
+        if (dirty) {
+            memcpy(line_transitions[y].to_from, to_from, sizeof(line_transitions[y].to_from));
+        } else {
+            memset(&line_transitions[y], 0, sizeof(EpdTransitions));
+        }
+    }
+    if (transitions != NULL && dirty) {
+        for (int i = 0; i < 16; i++) {
+            transitions->to_from[i] |= to_from[i];
+        }
+    }
+}
+
+/**
+ * Find the smallest rectangle within `crop_to` (clipped to `x_end`, `y_end`)
+ * containing all dirty lines and columns.
+ */
+static EpdRect dirty_bounding_box(
+    EpdRect crop_to, int x_end, int y_end, const bool* dirty_lines, const uint8_t* col_dirtyness
+) {
     int min_x, min_y, max_x, max_y;
     for (min_x = crop_to.x; min_x < x_end; min_x++) {
         uint8_t mask = min_x % 2 ? 0xF0 : 0x0F;
@@ -469,7 +1064,7 @@ EpdRect epd_difference_image_base(
             break;
     }
     for (max_x = x_end - 1; max_x >= crop_to.x; max_x--) {
-        uint8_t mask = min_x % 2 ? 0xF0 : 0x0F;
+        uint8_t mask = max_x % 2 ? 0xF0 : 0x0F;
         if ((col_dirtyness[max_x / 2] & mask) != 0)
             break;
     }
@@ -492,6 +1087,59 @@ EpdRect epd_difference_image_base(
     return crop_rect;
 }
 
+EpdRect epd_difference_image_base(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    int fb_width,
+    int fb_height,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+) {
+    assert(fb_width % 8 == 0);
+    assert(col_dirtyness != NULL);
+
+    // these buffers should be allocated 16 byte aligned
+    assert((uintptr_t)to % 16 == 0);
+    assert((uintptr_t)from % 16 == 0);
+    assert((uintptr_t)col_dirtyness % 16 == 0);
+    assert((uintptr_t)interlaced % 16 == 0);
+
+    memset(col_dirtyness, 0, fb_width / 2);
+    memset(dirty_lines, 0, sizeof(bool) * fb_height);
+    if (transitions != NULL) {
+        memset(transitions, 0, sizeof(EpdTransitions));
+    }
+    bool collect = transitions != NULL || line_transitions != NULL;
+
+    int x_end = min(fb_width, crop_to.x + crop_to.width);
+    int y_end = min(fb_height, crop_to.y + crop_to.height);
+
+    for (int y = crop_to.y; y < y_end; y++) {
+        uint32_t offset = y * fb_width / 2;
+        uint8_t* interlaced_line = interlaced != NULL ? interlaced + offset * 2 : NULL;
+        // the histogram is collected while the line is diffed, an unchanged line has none
+        uint16_t to_from[16] = { 0 };
+        int dirty = diff_line(
+            to + offset,
+            from + offset,
+            interlaced_line,
+            col_dirtyness,
+            fb_width,
+            collect ? to_from : NULL
+        );
+        dirty_lines[y] = dirty;
+        if (collect) {
+            store_line_transitions(to_from, y, dirty, transitions, line_transitions);
+        }
+    }
+
+    return dirty_bounding_box(crop_to, x_end, y_end, dirty_lines, col_dirtyness);
+}
+
 EpdRect epd_difference_image(
     const uint8_t* to,
     const uint8_t* from,
@@ -507,7 +1155,9 @@ EpdRect epd_difference_image(
         epd_height(),
         interlaced,
         dirty_lines,
-        col_dirtyness
+        col_dirtyness,
+        NULL,
+        NULL
     );
 }
 
@@ -520,7 +1170,216 @@ EpdRect epd_difference_image_cropped(
     uint8_t* col_dirtyness
 ) {
     EpdRect result = epd_difference_image_base(
-        to, from, crop_to, epd_width(), epd_height(), interlaced, dirty_lines, col_dirtyness
+        to,
+        from,
+        crop_to,
+        epd_width(),
+        epd_height(),
+        interlaced,
+        dirty_lines,
+        col_dirtyness,
+        NULL,
+        NULL
     );
     return result;
 }
+
+EpdRect epd_difference_image_transitions(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+) {
+    return epd_difference_image_base(
+        to,
+        from,
+        crop_to,
+        epd_width(),
+        epd_height(),
+        interlaced,
+        dirty_lines,
+        col_dirtyness,
+        transitions,
+        line_transitions
+    );
+}
+
+EpdRect epd_difference_image_tiles(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const uint8_t* dirty_tiles,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+) {
+    const int fb_width = epd_width();
+    const int fb_height = epd_height();
+    const int tiles_x = epd_damage_tiles_x();
+
+    assert(dirty_tiles != NULL);
+    assert(col_dirtyness != NULL);
+    assert(tiles_x <= MAX_DAMAGE_TILES_X);
+    assert((uintptr_t)to % 16 == 0);
+    assert((uintptr_t)from % 16 == 0);
+    assert((uintptr_t)col_dirtyness % 16 == 0);
+    assert((uintptr_t)interlaced % 16 == 0);
+
+    memset(col_dirtyness, 0, fb_width / 2);
+    memset(dirty_lines, 0, sizeof(bool) * fb_height);
+    if (transitions != NULL) {
+        memset(transitions, 0, sizeof(EpdTransitions));
+    }
+    bool collect = transitions != NULL || line_transitions != NULL;
+
+    int x_start = max(crop_to.x, 0);
+    int y_start = max(crop_to.y, 0);
+    int x_end = min(fb_width, crop_to.x + crop_to.width);
+    int y_end = min(fb_height, crop_to.y + crop_to.height);
+    if (x_start >= x_end || y_start >= y_end) {
+        EpdRect empty = { .x = x_start, .y = y_start, .width = 0, .height = 0 };
+        return empty;
+    }
+
+    int tx_start = x_start / EPD_DAMAGE_TILE_SIZE;
+    int tx_end = (x_end - 1) / EPD_DAMAGE_TILE_SIZE + 1;
+    int ty_start = y_start / EPD_DAMAGE_TILE_SIZE;
+    int ty_end = (y_end - 1) / EPD_DAMAGE_TILE_SIZE + 1;
+
+    // Tile columns with at least one dirty tile in the crop area.
+    // All of them are calculated for every line of a dirty tile row,
+    // so the column mask never exposes stale difference data.
+    uint32_t tile_columns[MAX_DAMAGE_TILES_X / 32] = { 0 };
+    for (int ty = ty_start; ty < ty_end; ty++) {
+        const uint8_t* row = dirty_tiles + ty * tiles_x;
+        for (int tx = tx_start; tx < tx_end; tx++) {
+            if (row[tx] != 0) {
+                set_tile_bit(tile_columns, tx, true);
+            }
+        }
+    }
+
+    for (int ty = ty_start; ty < ty_end; ty++) {
+        const uint8_t* row = dirty_tiles + ty * tiles_x;
+        bool row_dirty = false;
+        for (int tx = tx_start; tx < tx_end; tx++) {
+            row_dirty |= row[tx] != 0;
+        }
+        int line_start = max(ty * EPD_DAMAGE_TILE_SIZE, y_start);
+        int line_end = min((ty + 1) * EPD_DAMAGE_TILE_SIZE, y_end);
+        if (!row_dirty) {
+            for (int y = line_start; y < line_end && line_transitions != NULL; y++) {
+                memset(&line_transitions[y], 0, sizeof(EpdTransitions));
+            }
+            continue;
+        }
+
+        for (int y = line_start; y < line_end; y++) {
+            uint32_t offset = y * fb_width / 2;
+            uint16_t to_from[16] = { 0 };
+            // tiles of spans which were not interlaced because they are unchanged
+            uint32_t skipped_tiles[MAX_DAMAGE_TILES_X / 32];
+            bool skipped = false;
+            bool dirty = false;
+            int tx = tx_start;
+            while (tx < tx_end) {
+                if (!tile_bit(tile_columns, tx)) {
+                    tx++;
+                    continue;
+                }
+                int run_start = tx;
+                while (tx < tx_end && tile_bit(tile_columns, tx)) {
+                    tx++;
+                }
+                int span_x = run_start * EPD_DAMAGE_TILE_SIZE;
+                int span_len = min(tx * EPD_DAMAGE_TILE_SIZE, fb_width) - span_x;
+                uint8_t* interlaced_span
+                    = interlaced != NULL ? interlaced + offset * 2 + span_x : NULL;
+                bool span_dirty = diff_line(
+                    to + offset + span_x / 2,
+                    from + offset + span_x / 2,
+                    interlaced_span,
+                    col_dirtyness + span_x / 2,
+                    span_len,
+                    collect ? to_from : NULL
+                );
+                for (int t = run_start; t < tx; t++) {
+                    set_tile_bit(skipped_tiles, t, !span_dirty && interlaced != NULL);
+                }
+                skipped |= !span_dirty && interlaced != NULL;
+                dirty |= span_dirty;
+            }
+            dirty_lines[y] = dirty;
+
+            // Unchanged pixels of a dirty line are driven in the columns changed
+            // by other lines, so the unchanged spans must be interlaced, too.
+            // They were just compared and are still in the cache.
+            if (dirty && skipped) {
+                for (int tx = tx_start; tx < tx_end; tx++) {
+                    if (tile_bit(tile_columns, tx) && tile_bit(skipped_tiles, tx)) {
+                        int x = tx * EPD_DAMAGE_TILE_SIZE;
+                        interlace_line(
+                            to + offset + x / 2,
+                            from + offset + x / 2,
+                            interlaced + offset * 2 + x,
+                            col_dirtyness + x / 2,
+                            min(EPD_DAMAGE_TILE_SIZE, fb_width - x),
+                            collect ? to_from : NULL
+                        );
+                    }
+                }
+            }
+            if (collect) {
+                store_line_transitions(to_from, y, dirty, transitions, line_transitions);
+            }
+        }
+    }
+
+    crop_to.x = x_start;
+    crop_to.y = y_start;
+    return dirty_bounding_box(crop_to, x_end, y_end, dirty_lines, col_dirtyness);
+}
+
+EpdRect epd_difference_4ppb_cropped(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness
+) {
+    const int fb_width = epd_width();
+    const int fb_height = epd_height();
+    const int line_bytes = fb_width / 4;
+    assert(fb_width % 4 == 0);
+
+    memset(col_dirtyness, 0, fb_width / 2);
+    memset(dirty_lines, 0, sizeof(bool) * fb_height);
+
+    int x_end = min(fb_width, crop_to.x + crop_to.width);
+    int y_end = min(fb_height, crop_to.y + crop_to.height);
+
+    for (int y = crop_to.y; y < y_end; y++) {
+        const uint8_t* t = to + y * line_bytes;
+        const uint8_t* f = from + y * line_bytes;
+        bool dirty = false;
+        for (int i = 0; i < line_bytes; i++) {
+            uint8_t d = t[i] ^ f[i];
+            if (d == 0) {
+                continue;
+            }
+            dirty = true;
+            // spread the four changed pixels to one nibble per column
+            col_dirtyness[2 * i] |= ((d & 0x03) ? 0x0F : 0x00) | ((d & 0x0C) ? 0xF0 : 0x00);
+            col_dirtyness[2 * i + 1] |= ((d & 0x30) ? 0x0F : 0x00) | ((d & 0xC0) ? 0xF0 : 0x00);
+        }
+        dirty_lines[y] = dirty;
+    }
+
+    return dirty_bounding_box(crop_to, x_end, y_end, dirty_lines, col_dirtyness);
+}
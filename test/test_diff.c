@@ -5,6 +5,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <unity.h>
+#include "epdiy.h"
 #include "esp_timer.h"
 
 #define DEFAULT_EXAMPLE_LEN 704
@@ -17,6 +18,19 @@ bool _epd_interlace_line(
     int fb_width
 );
 
+EpdRect epd_difference_image_base(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    int fb_width,
+    int fb_height,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitions* transitions,
+    EpdTransitions* line_transitions
+);
+
 static const uint8_t from_pattern[8] = { 0xFF, 0xF0, 0x0F, 0x01, 0x55, 0xAA, 0xFF, 0x80 };
 static const uint8_t to_pattern[8] = { 0xFF, 0xFF, 0x0F, 0x10, 0xAA, 0x55, 0xFF, 0x00 };
 
@@ -86,7 +100,7 @@ TEST_CASE("simple aligned diff works", "[epdiy,unit]") {
     diff_test_buffers_init(&bufs, example_len);
 
     // This should trigger use of vector extensions on the S3
-    TEST_ASSERT((uint32_t)bufs.to % 16 == 0);
+    TEST_ASSERT((uintptr_t)bufs.to % 16 == 0);
 
     // fully aligned
     dirty = _epd_interlace_line(
@@ -109,7 +123,7 @@ TEST_CASE("dirtynes for diff without changes is correct", "[epdiy,unit]") {
     diff_test_buffers_init(&bufs, example_len);
 
     // This should trigger use of vector extensions on the S3
-    TEST_ASSERT((uint32_t)bufs.to % 16 == 0);
+    TEST_ASSERT((uintptr_t)bufs.to % 16 == 0);
 
     // both use "from" buffer
     dirty = _epd_interlace_line(
@@ -130,6 +144,31 @@ TEST_CASE("dirtynes for diff without changes is correct", "[epdiy,unit]") {
     diff_test_buffers_free(&bufs);
 }
 
+TEST_CASE("unchanged chunks are interlaced with themselves", "[epdiy,unit]") {
+    const int example_len = DEFAULT_EXAMPLE_LEN;
+    DiffTestBuffers bufs;
+
+    diff_test_buffers_init(&bufs, example_len);
+
+    // a single changed chunk of 16 bytes among unchanged ones
+    memcpy(bufs.from, bufs.to, example_len);
+    bufs.from[37] ^= 0x30;
+
+    bool dirty = _epd_interlace_line(
+        bufs.to, bufs.from, bufs.interlaced, bufs.col_dirtyness, 2 * example_len
+    );
+
+    TEST_ASSERT(dirty == true);
+    for (int x = 0; x < 2 * example_len; x++) {
+        uint8_t t = (bufs.to[x / 2] >> (4 * (x % 2))) & 0x0F;
+        uint8_t f = (bufs.from[x / 2] >> (4 * (x % 2))) & 0x0F;
+        TEST_ASSERT_EQUAL_UINT8((t << 4) | f, bufs.interlaced[x]);
+        TEST_ASSERT_EQUAL_UINT8(x / 2 == 37 ? 0x30 : 0x00, bufs.col_dirtyness[x / 2]);
+    }
+
+    diff_test_buffers_free(&bufs);
+}
+
 TEST_CASE("different 4-byte alignments work", "[epdiy,unit]") {
     const int example_len = DEFAULT_EXAMPLE_LEN;
     DiffTestBuffers bufs;
@@ -181,4 +220,120 @@ TEST_CASE("different 4-byte alignments work", "[epdiy,unit]") {
     }
 
     diff_test_buffers_free(&bufs);
-}
\ No newline at end of file
+}
+
+TEST_CASE("unchanged lines are not written to the difference image", "[epdiy,unit]") {
+    const int width = 256;
+    const int height = 4;
+    uint8_t* to = heap_caps_aligned_alloc(16, width / 2 * height, MALLOC_CAP_DEFAULT);
+    uint8_t* from = heap_caps_aligned_alloc(16, width / 2 * height, MALLOC_CAP_DEFAULT);
+    uint8_t* interlaced = heap_caps_aligned_alloc(16, width * height, MALLOC_CAP_DEFAULT);
+    uint8_t* col_dirtyness = heap_caps_aligned_alloc(16, width / 2, MALLOC_CAP_DEFAULT);
+    bool dirty_lines[4];
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(interlaced);
+    TEST_ASSERT_NOT_NULL(col_dirtyness);
+
+    memset(to, 0x5A, width / 2 * height);
+    memset(from, 0x5A, width / 2 * height);
+    memset(interlaced, 0xEE, width * height);
+    // a change in the last pixel of line 2
+    to[width / 2 * 3 - 1] = 0xFA;
+
+    EpdRect full = { .x = 0, .y = 0, .width = width, .height = height };
+    EpdRect changed = epd_difference_image_base(
+        to, from, full, width, height, interlaced, dirty_lines, col_dirtyness, NULL, NULL
+    );
+
+    TEST_ASSERT_EQUAL(width - 1, changed.x);
+    TEST_ASSERT_EQUAL(2, changed.y);
+    TEST_ASSERT_EQUAL(1, changed.width);
+    TEST_ASSERT_EQUAL(1, changed.height);
+    for (int y = 0; y < height; y++) {
+        TEST_ASSERT(dirty_lines[y] == (y == 2));
+        for (int x = 0; x < width; x++) {
+            uint8_t expected = 0xEE;
+            if (y == 2) {
+                expected = x % 2 ? 0x55 : 0xAA;
+                expected = x == width - 1 ? 0xF5 : expected;
+            }
+            TEST_ASSERT_EQUAL_UINT8(expected, interlaced[y * width + x]);
+        }
+    }
+
+    heap_caps_free(to);
+    heap_caps_free(from);
+    heap_caps_free(interlaced);
+    heap_caps_free(col_dirtyness);
+}
+
+TEST_CASE("transitions of dirty lines are collected while diffing", "[epdiy,unit]") {
+    const int width = 256;
+    const int height = 6;
+    const int line_bytes = width / 2;
+    uint8_t* to = heap_caps_aligned_alloc(16, line_bytes * height, MALLOC_CAP_DEFAULT);
+    uint8_t* from = heap_caps_aligned_alloc(16, line_bytes * height, MALLOC_CAP_DEFAULT);
+    uint8_t* interlaced = heap_caps_aligned_alloc(16, width * height, MALLOC_CAP_DEFAULT);
+    uint8_t* col_dirtyness = heap_caps_aligned_alloc(16, line_bytes, MALLOC_CAP_DEFAULT);
+    bool dirty_lines[6];
+    EpdTransitions transitions;
+    EpdTransitions line_transitions[6];
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(interlaced);
+    TEST_ASSERT_NOT_NULL(col_dirtyness);
+
+    // uniform backgrounds, gradients and a single changed pixel, some lines unchanged
+    memset(to, 0xFF, line_bytes * height);
+    memset(from, 0xFF, line_bytes * height);
+    memset(to + 1 * line_bytes, 0x00, 40);
+    for (int i = 0; i < line_bytes; i++) {
+        to[2 * line_bytes + i] = (i * 7) & 0xFF;
+        from[2 * line_bytes + i] = (i * 13) & 0xFF;
+        to[3 * line_bytes + i] = (i * 5) & 0xFF;
+        from[3 * line_bytes + i] = (i * 5) & 0xFF;
+    }
+    to[5 * line_bytes + line_bytes - 1] = 0x3F;
+
+    EpdRect full = { .x = 0, .y = 0, .width = width, .height = height };
+    for (int pass = 0; pass < 2; pass++) {
+        memset(line_transitions, 0xAA, sizeof(line_transitions));
+        epd_difference_image_base(
+            to,
+            from,
+            full,
+            width,
+            height,
+            pass ? interlaced : NULL,
+            dirty_lines,
+            col_dirtyness,
+            &transitions,
+            line_transitions
+        );
+
+        EpdTransitions expected = { 0 };
+        for (int y = 0; y < height; y++) {
+            uint16_t to_from[16] = { 0 };
+            for (int x = 0; x < width; x++) {
+                uint8_t t = (to[y * line_bytes + x / 2] >> (4 * (x % 2))) & 0x0F;
+                uint8_t f = (from[y * line_bytes + x / 2] >> (4 * (x % 2))) & 0x0F;
+                to_from[t] |= 1 << f;
+            }
+            TEST_ASSERT(dirty_lines[y] == (y == 1 || y == 2 || y == 5));
+            for (int i = 0; i < 16; i++) {
+                uint16_t line_expected = dirty_lines[y] ? to_from[i] : 0;
+                TEST_ASSERT_EQUAL_UINT16(line_expected, line_transitions[y].to_from[i]);
+                expected.to_from[i] |= line_expected;
+            }
+        }
+        for (int i = 0; i < 16; i++) {
+            TEST_ASSERT_EQUAL_UINT16(expected.to_from[i], transitions.to_from[i]);
+        }
+    }
+
+    heap_caps_free(to);
+    heap_caps_free(from);
+    heap_caps_free(interlaced);
+    heap_caps_free(col_dirtyness);
+}
@@ -0,0 +1,479 @@
+#include <esp_heap_caps.h>
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epdiy.h"
+
+// choose the default demo board depending on the architecture
+#ifdef CONFIG_IDF_TARGET_ESP32
+#define TEST_BOARD epd_board_v6
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+#define TEST_BOARD epd_board_v7
+#elif defined(CONFIG_IDF_TARGET_LINUX)
+#define TEST_BOARD epd_board_host
+#endif
+
+static const enum EpdRotation test_rotations[] = {
+    EPD_ROT_LANDSCAPE,
+    EPD_ROT_PORTRAIT,
+    EPD_ROT_INVERTED_LANDSCAPE,
+    EPD_ROT_INVERTED_PORTRAIT,
+};
+
+/// Rectangles in rotated coordinates, with uneven edges and partially off-screen.
+static const EpdRect test_rects[] = {
+    { .x = 0, .y = 0, .width = 1, .height = 1 },
+    { .x = 3, .y = 7, .width = 1, .height = 40 },
+    { .x = 10, .y = 5, .width = 1, .height = 1 },
+    { .x = 11, .y = 20, .width = 2, .height = 3 },
+    { .x = 101, .y = 33, .width = 250, .height = 17 },
+    { .x = 64, .y = 64, .width = 64, .height = 64 },
+    { .x = -30, .y = -11, .width = 61, .height = 80 },
+    { .x = 1190, .y = 790, .width = 100, .height = 100 },
+    { .x = 5, .y = 5, .width = 0, .height = 10 },
+};
+
+/// Fill `rect` pixel by pixel, as the reference for the span fillers.
+static void fill_rect_pixels(EpdRect rect, uint8_t color, uint8_t* framebuffer) {
+    for (int y = rect.y; y < rect.y + rect.height; y++) {
+        for (int x = rect.x; x < rect.x + rect.width; x++) {
+            epd_draw_pixel(x, y, color, framebuffer);
+        }
+    }
+}
+
+TEST_CASE("pixels are mapped to the framebuffer per rotation", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int w = epd_width();
+    int h = epd_height();
+    int fb_size = w / 2 * h;
+    uint8_t* fb = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(fb);
+
+    // framebuffer coordinates of rotated pixel (3, 6)
+    const int expected_x[] = { 3, w - 1 - 6, w - 1 - 3, 6 };
+    const int expected_y[] = { 6, 3, h - 1 - 6, h - 1 - 3 };
+
+    for (int r = 0; r < sizeof(test_rotations) / sizeof(test_rotations[0]); r++) {
+        epd_set_rotation(test_rotations[r]);
+        memset(fb, 0xFF, fb_size);
+
+        epd_draw_pixel(3, 6, 0x50, fb);
+        // outside of the display, must not be drawn
+        epd_draw_pixel(-1, 6, 0x00, fb);
+        epd_draw_pixel(3, -1, 0x00, fb);
+        epd_draw_pixel(epd_rotated_display_width(), 6, 0x00, fb);
+        epd_draw_pixel(3, epd_rotated_display_height(), 0x00, fb);
+
+        int x = expected_x[r];
+        int y = expected_y[r];
+        uint8_t expected_byte = x % 2 ? 0x5F : 0xF5;
+        for (int i = 0; i < fb_size; i++) {
+            TEST_ASSERT_EQUAL_UINT8(i == y * w / 2 + x / 2 ? expected_byte : 0xFF, fb[i]);
+        }
+    }
+
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    heap_caps_free(fb);
+    epd_deinit();
+}
+
+TEST_CASE("span fills match pixel-wise drawing in all rotations", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* expected = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* actual = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* expected_tiles = calloc(epd_damage_tiles_x() * epd_damage_tiles_y(), 1);
+    uint8_t* actual_tiles = calloc(epd_damage_tiles_x() * epd_damage_tiles_y(), 1);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_NOT_NULL(expected_tiles);
+    TEST_ASSERT_NOT_NULL(actual_tiles);
+    memset(expected, 0x5A, fb_size);
+    memset(actual, 0x5A, fb_size);
+
+    for (int r = 0; r < sizeof(test_rotations) / sizeof(test_rotations[0]); r++) {
+        epd_set_rotation(test_rotations[r]);
+        for (int i = 0; i < sizeof(test_rects) / sizeof(test_rects[0]); i++) {
+            EpdRect rect = test_rects[i];
+            uint8_t color = (i * 0x30 + r * 0x10) & 0xF0;
+
+            epd_track_damage(expected, expected_tiles);
+            fill_rect_pixels(rect, color, expected);
+            epd_track_damage(actual, actual_tiles);
+            epd_fill_rect(rect, color, actual);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+
+            epd_track_damage(expected, expected_tiles);
+            fill_rect_pixels((EpdRect){ rect.x, rect.y + 1, rect.width, 1 }, ~color, expected);
+            fill_rect_pixels((EpdRect){ rect.x + 1, rect.y, 1, rect.height }, ~color, expected);
+            epd_track_damage(actual, actual_tiles);
+            epd_draw_hline(rect.x, rect.y + 1, rect.width, ~color, actual);
+            epd_draw_vline(rect.x + 1, rect.y, rect.height, ~color, actual);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+        }
+    }
+    int tiles = epd_damage_tiles_x() * epd_damage_tiles_y();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_tiles, actual_tiles, tiles);
+
+    epd_track_damage(NULL, NULL);
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    free(expected_tiles);
+    free(actual_tiles);
+    heap_caps_free(expected);
+    heap_caps_free(actual);
+    epd_deinit();
+}
+
+TEST_CASE("drawing is restricted to the clip rectangle", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* unclipped = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* clipped = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* visible = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(unclipped);
+    TEST_ASSERT_NOT_NULL(clipped);
+    TEST_ASSERT_NOT_NULL(visible);
+
+    const EpdRect outer = { .x = 50, .y = 40, .width = 301, .height = 200 };
+    const EpdRect inner = { .x = 101, .y = 0, .width = 500, .height = 171 };
+    // intersection of both clip rectangles
+    const EpdRect clip = { .x = 101, .y = 40, .width = 250, .height = 131 };
+
+    for (int r = 0; r < sizeof(test_rotations) / sizeof(test_rotations[0]); r++) {
+        epd_set_rotation(test_rotations[r]);
+        memset(unclipped, 0xFF, fb_size);
+        memset(clipped, 0xFF, fb_size);
+
+        for (int pass = 0; pass < 2; pass++) {
+            uint8_t* fb = pass ? clipped : unclipped;
+            if (pass) {
+                epd_push_clip(outer);
+                epd_push_clip(inner);
+            }
+            epd_fill_rect(test_rects[4], 0x00, fb);
+            epd_draw_circle(200, 100, 80, 0x30, fb);
+            epd_fill_circle(150, 150, 30, 0x60, fb);
+            epd_draw_line(0, 0, 400, 300, 0x90, fb);
+            epd_fill_triangle(90, 30, 380, 120, 120, 250, 0xC0, fb);
+            // fully outside of the clip rectangle
+            epd_fill_rect((EpdRect){ 500, 300, 40, 40 }, 0x00, fb);
+            if (pass) {
+                epd_pop_clip();
+                epd_pop_clip();
+            }
+        }
+
+        // after popping, drawing is unrestricted again
+        epd_draw_pixel(0, 0, 0x00, clipped);
+        epd_draw_pixel(0, 0, 0x00, unclipped);
+
+        // pixels which may differ from the background, in framebuffer layout
+        memset(visible, 0xFF, fb_size);
+        epd_fill_rect(clip, 0x00, visible);
+        epd_draw_pixel(0, 0, 0x00, visible);
+
+        int drawn = 0;
+        for (int i = 0; i < fb_size; i++) {
+            TEST_ASSERT_EQUAL_UINT8((unclipped[i] & ~visible[i]) | visible[i], clipped[i]);
+            drawn += clipped[i] != 0xFF;
+        }
+        TEST_ASSERT(drawn > 1);
+    }
+
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    heap_caps_free(unclipped);
+    heap_caps_free(clipped);
+    heap_caps_free(visible);
+    epd_deinit();
+}
+
+/// Copy an image pixel by pixel, as the reference for the row-wise blitter.
+static void copy_pixels(EpdRect area, const uint8_t* image, uint8_t* framebuffer) {
+    int line_bytes = area.width / 2 + area.width % 2;
+    for (int y = 0; y < area.height; y++) {
+        for (int x = 0; x < area.width; x++) {
+            uint8_t byte = image[y * line_bytes + x / 2];
+            uint8_t value = x % 2 ? byte & 0xF0 : byte << 4;
+            epd_draw_pixel(area.x + x, area.y + y, value, framebuffer);
+        }
+    }
+}
+
+TEST_CASE("images are copied row-wise at any nibble phase", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* expected = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* actual = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* image = heap_caps_malloc(200 * 100, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_NOT_NULL(image);
+    for (int i = 0; i < 200 * 100; i++) {
+        image[i] = i * 37 + i / 7;
+    }
+    memset(expected, 0x5A, fb_size);
+    memset(actual, 0x5A, fb_size);
+
+    const EpdRect areas[] = {
+        { .x = 0, .y = 0, .width = 200, .height = 100 },
+        { .x = 33, .y = 5, .width = 200, .height = 100 },
+        { .x = 10, .y = 300, .width = 151, .height = 80 },
+        { .x = 301, .y = 17, .width = 77, .height = 99 },
+        { .x = 555, .y = 400, .width = 1, .height = 20 },
+        { .x = -7, .y = -3, .width = 99, .height = 60 },
+        { .x = -8, .y = 700, .width = 100, .height = 150 },
+        { .x = 1150, .y = 500, .width = 101, .height = 50 },
+    };
+    for (int i = 0; i < sizeof(areas) / sizeof(areas[0]); i++) {
+        copy_pixels(areas[i], image, expected);
+        epd_copy_to_framebuffer(areas[i], image, actual);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+    }
+
+    // with a clip rectangle of uneven bounds
+    EpdRect clip = { .x = 41, .y = 20, .width = 57, .height = 33 };
+    epd_push_clip(clip);
+    for (int i = 0; i < 3; i++) {
+        copy_pixels(areas[i], image + 1000, expected);
+        epd_copy_to_framebuffer(areas[i], image + 1000, actual);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+    }
+    epd_pop_clip();
+
+    heap_caps_free(expected);
+    heap_caps_free(actual);
+    heap_caps_free(image);
+    epd_deinit();
+}
+
+/// Draw an image pixel by pixel, as the reference for the rotated blitter.
+static void draw_image_pixels(EpdRect area, const uint8_t* image, int transparent, uint8_t* fb) {
+    for (int y = 0; y < area.height; y++) {
+        for (int x = 0; x < area.width; x++) {
+            uint8_t color = epd_get_pixel(x, y, area.width, area.height, image);
+            if (color != transparent) {
+                epd_draw_pixel(area.x + x, area.y + y, color, fb);
+            }
+        }
+    }
+}
+
+TEST_CASE("rotated images match pixel-wise drawing in all rotations", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* expected = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* actual = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* image = heap_caps_malloc(100 * 100, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_NOT_NULL(image);
+    for (int i = 0; i < 100 * 100; i++) {
+        image[i] = i * 37 + i / 7;
+    }
+    memset(expected, 0x5A, fb_size);
+    memset(actual, 0x5A, fb_size);
+
+    const EpdRect areas[] = {
+        { .x = 0, .y = 0, .width = 100, .height = 100 },
+        { .x = 33, .y = 5, .width = 101, .height = 60 },
+        { .x = 10, .y = 301, .width = 17, .height = 1 },
+        { .x = -7, .y = -3, .width = 99, .height = 60 },
+        { .x = 780, .y = 1150, .width = 40, .height = 80 },
+    };
+    for (int r = 0; r < sizeof(test_rotations) / sizeof(test_rotations[0]); r++) {
+        epd_set_rotation(test_rotations[r]);
+        for (int i = 0; i < sizeof(areas) / sizeof(areas[0]); i++) {
+            draw_image_pixels(areas[i], image, -1, expected);
+            epd_draw_rotated_image(areas[i], image, actual);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+
+            draw_image_pixels(areas[i], image + 77, 0x30, expected);
+            epd_draw_rotated_transparent_image(areas[i], image + 77, actual, 0x30);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+        }
+
+        EpdRect clip = { .x = 41, .y = 20, .width = 57, .height = 33 };
+        epd_push_clip(clip);
+        draw_image_pixels(areas[1], image + 5, -1, expected);
+        epd_draw_rotated_image(areas[1], image + 5, actual);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+        epd_pop_clip();
+    }
+
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    heap_caps_free(expected);
+    heap_caps_free(actual);
+    heap_caps_free(image);
+    epd_deinit();
+}
+
+/// Draw a line pixel by pixel, as the reference for the strided line drawing.
+static void draw_line_pixels(int x0, int y0, int x1, int y1, uint8_t color, uint8_t* fb) {
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+        int t = x0;
+        x0 = y0;
+        y0 = t;
+        t = x1;
+        x1 = y1;
+        y1 = t;
+    }
+    if (x0 > x1) {
+        int t = x0;
+        x0 = x1;
+        x1 = t;
+        t = y0;
+        y0 = y1;
+        y1 = t;
+    }
+    int dx = x1 - x0;
+    int dy = abs(y1 - y0);
+    int err = dx / 2;
+    int ystep = y0 < y1 ? 1 : -1;
+    for (; x0 <= x1; x0++) {
+        if (steep) {
+            epd_draw_pixel(y0, x0, color, fb);
+        } else {
+            epd_draw_pixel(x0, y0, color, fb);
+        }
+        err -= dy;
+        if (err < 0) {
+            y0 += ystep;
+            err += dx;
+        }
+    }
+}
+
+/// Draw a circle pixel by pixel, as the reference for the strided circle drawing.
+static void draw_circle_pixels(int x0, int y0, int r, uint8_t color, uint8_t* fb) {
+    int f = 1 - r;
+    int ddF_x = 1;
+    int ddF_y = -2 * r;
+    int x = 0;
+    int y = r;
+    epd_draw_pixel(x0, y0 + r, color, fb);
+    epd_draw_pixel(x0, y0 - r, color, fb);
+    epd_draw_pixel(x0 + r, y0, color, fb);
+    epd_draw_pixel(x0 - r, y0, color, fb);
+    while (x < y) {
+        if (f >= 0) {
+            y--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        epd_draw_pixel(x0 + x, y0 + y, color, fb);
+        epd_draw_pixel(x0 - x, y0 + y, color, fb);
+        epd_draw_pixel(x0 + x, y0 - y, color, fb);
+        epd_draw_pixel(x0 - x, y0 - y, color, fb);
+        epd_draw_pixel(x0 + y, y0 + x, color, fb);
+        epd_draw_pixel(x0 - y, y0 + x, color, fb);
+        epd_draw_pixel(x0 + y, y0 - x, color, fb);
+        epd_draw_pixel(x0 - y, y0 - x, color, fb);
+    }
+}
+
+TEST_CASE(
+    "lines, circles and pixel rows match pixel-wise drawing in all rotations", "[epdiy,e2e]"
+) {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_OPTIONS_DEFAULT);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    int tiles = epd_damage_tiles_x() * epd_damage_tiles_y();
+    uint8_t* expected = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* actual = heap_caps_malloc(fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* expected_tiles = calloc(tiles, 1);
+    uint8_t* actual_tiles = calloc(tiles, 1);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_NOT_NULL(expected_tiles);
+    TEST_ASSERT_NOT_NULL(actual_tiles);
+    memset(expected, 0x5A, fb_size);
+    memset(actual, 0x5A, fb_size);
+
+    // lines in all octants, partially off-screen
+    const int lines[][4] = {
+        { 10, 10, 300, 77 }, { 300, 77, 10, 10 },   { 20, 5, 41, 400 },  { 41, 400, 20, 5 },
+        { 5, 300, 200, 250 }, { 90, 20, 60, 200 }, { -50, -20, 100, 30 }, { 700, 790, 1300, 900 },
+        { 33, 33, 133, 133 }, { 3, 50, 4, 51 },
+    };
+    const int circles[][3] = { { 200, 150, 80 }, { 11, 13, 30 }, { 700, 400, 1 }, { 50, 60, 0 } };
+    uint8_t colors[300];
+    for (int i = 0; i < sizeof(colors); i++) {
+        colors[i] = (i * 0x70 + i / 3) & 0xF0;
+    }
+    const EpdRect rows[] = {
+        { .x = 0, .y = 0, .width = 300 }, { .x = 17, .y = 99, .width = 1 },
+        { .x = -40, .y = 5, .width = 100 }, { .x = 1150, .y = 790, .width = 200 },
+        { .x = 101, .y = 500, .width = 33 },
+    };
+
+    for (int r = 0; r < sizeof(test_rotations) / sizeof(test_rotations[0]); r++) {
+        epd_set_rotation(test_rotations[r]);
+        for (int clip = 0; clip < 2; clip++) {
+            if (clip) {
+                epd_push_clip((EpdRect){ .x = 31, .y = 20, .width = 250, .height = 301 });
+            }
+            for (int i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+                uint8_t color = (i * 0x50 + r * 0x10) & 0xF0;
+                const int* l = lines[i];
+                epd_track_damage(expected, expected_tiles);
+                draw_line_pixels(l[0], l[1], l[2], l[3], color, expected);
+                epd_track_damage(actual, actual_tiles);
+                epd_draw_line(l[0], l[1], l[2], l[3], color, actual);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+            }
+            for (int i = 0; i < sizeof(circles) / sizeof(circles[0]); i++) {
+                uint8_t color = (i * 0x30 + 0x40) & 0xF0;
+                const int* c = circles[i];
+                epd_track_damage(expected, expected_tiles);
+                draw_circle_pixels(c[0], c[1], c[2], color, expected);
+                epd_track_damage(actual, actual_tiles);
+                epd_draw_circle(c[0], c[1], c[2], color, actual);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+            }
+
+            epd_track_damage(expected, expected_tiles);
+            draw_line_pixels(90, 30, 380, 120, 0x20, expected);
+            draw_line_pixels(380, 120, 120, 250, 0x20, expected);
+            draw_line_pixels(120, 250, 90, 30, 0x20, expected);
+            epd_track_damage(actual, actual_tiles);
+            epd_draw_triangle(90, 30, 380, 120, 120, 250, 0x20, actual);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+
+            for (int i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+                const uint8_t* row_colors = colors + i;
+                epd_track_damage(expected, expected_tiles);
+                for (int x = 0; x < rows[i].width; x++) {
+                    epd_draw_pixel(rows[i].x + x, rows[i].y, row_colors[x], expected);
+                }
+                epd_track_damage(actual, actual_tiles);
+                epd_draw_pixel_row(rows[i].x, rows[i].y, rows[i].width, row_colors, actual);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, fb_size);
+            }
+            if (clip) {
+                epd_pop_clip();
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_tiles, actual_tiles, tiles);
+
+    epd_track_damage(NULL, NULL);
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    free(expected_tiles);
+    free(actual_tiles);
+    heap_caps_free(expected);
+    heap_caps_free(actual);
+    epd_deinit();
+}
@@ -0,0 +1,1199 @@
+#include <sdkconfig.h>
+
+// the simulated panel is only available on the host
+#ifdef CONFIG_IDF_TARGET_LINUX
+
+#include <esp_heap_caps.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epdiy.h"
+#include "output_common/lut.h"
+#include "output_host/panel_model.h"
+#include "output_host/render_host.h"
+
+int waveform_temp_range_index(const EpdWaveform* waveform, int temperature);
+
+static const uint8_t* captured_line(const EpdHostCapture* capture, int frame, int line) {
+    return capture->data + ((size_t)frame * capture->lines + line) * capture->line_bytes;
+}
+
+static bool line_is_noop(const EpdHostCapture* capture, int frame, int line) {
+    const uint8_t* data = captured_line(capture, frame, line);
+    for (int i = 0; i < capture->line_bytes; i++) {
+        if (data[i] != 0x00) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("host render captures the drive data of an update", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+    const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    memset(framebuffer, 0x00, fb_size);
+
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        NULL,
+        waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    const EpdHostCapture* capture = epd_host_capture();
+    TEST_ASSERT(capture->frames > 0);
+    TEST_ASSERT_EQUAL(epd_height(), capture->lines);
+    TEST_ASSERT_EQUAL(epd_width() / 4, capture->line_bytes);
+
+    // white to black darkens all pixels in some frame, uniformly in all lines
+    bool darkened = false;
+    for (int f = 0; f < capture->frames; f++) {
+        const uint8_t* first = captured_line(capture, f, 0);
+        for (int l = 1; l < capture->lines; l++) {
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(first, captured_line(capture, f, l), capture->line_bytes);
+        }
+        darkened |= first[0] == DARK_BYTE;
+    }
+    TEST_ASSERT(darkened);
+
+    // only the drawn lines are driven
+    bool* drawn_lines = calloc(epd_height(), sizeof(bool));
+    TEST_ASSERT_NOT_NULL(drawn_lines);
+    for (int l = 10; l < 20; l++) {
+        drawn_lines[l] = true;
+    }
+    err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        drawn_lines,
+        NULL,
+        waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    darkened = false;
+    for (int f = 0; f < capture->frames; f++) {
+        for (int l = 0; l < capture->lines; l++) {
+            if (!drawn_lines[l]) {
+                TEST_ASSERT(line_is_noop(capture, f, l));
+            }
+        }
+        darkened |= captured_line(capture, f, 10)[0] == DARK_BYTE;
+    }
+    TEST_ASSERT(darkened);
+
+    free(drawn_lines);
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+/// A copy of the drive data of the last captured update.
+static uint8_t* copy_capture(int* frames) {
+    const EpdHostCapture* capture = epd_host_capture();
+    size_t size = (size_t)capture->frames * capture->lines * capture->line_bytes;
+    uint8_t* data = malloc(size > 0 ? size : 1);
+    TEST_ASSERT_NOT_NULL(data);
+    memcpy(data, capture->data, size);
+    *frames = capture->frames;
+    return data;
+}
+
+/// Fill a 4bpp framebuffer with all gray levels, varying with `seed`.
+static void fill_test_image(uint8_t* framebuffer, int seed) {
+    int line_bytes = epd_width() / 2;
+    for (int y = 0; y < epd_height(); y++) {
+        for (int i = 0; i < line_bytes; i++) {
+            uint8_t low = (i * seed + y) % 16;
+            uint8_t high = (i + y * seed / 4) % 16;
+            framebuffer[y * line_bytes + i] = (high << 4) | low;
+        }
+    }
+}
+
+/// Draw a gradient with the given init options, returns a copy of the captured data.
+static uint8_t* capture_gradient(enum EpdInitOptions options, int* frames) {
+    epd_init(&epd_board_host, &ED097TC2, options);
+    epd_host_set_capture(true);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    for (int i = 0; i < fb_size; i++) {
+        framebuffer[i] = (i / (epd_width() / 2) % 16) * 0x11;
+    }
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        NULL,
+        epd_get_display()->default_waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    uint8_t* data = copy_capture(frames);
+
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+    return data;
+}
+
+TEST_CASE("render output does not depend on the number of workers", "[epdiy,e2e]") {
+    int frames;
+    uint8_t* expected = capture_gradient(EPD_LUT_64K, &frames);
+    size_t size = (size_t)frames * ED097TC2.height * ED097TC2.width / 4;
+
+    const enum EpdInitOptions options[] = {
+        EPD_LUT_64K | EPD_RENDER_WORKERS(1),
+        EPD_LUT_64K | EPD_RENDER_WORKERS(1) | EPD_FEED_QUEUE_8,
+        EPD_LUT_64K | EPD_RENDER_WORKERS(3) | EPD_RENDER_CORE_1,
+        EPD_LUT_64K | EPD_RENDER_WORKERS(8) | EPD_RENDER_NO_AFFINITY,
+    };
+    for (int i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        int worker_frames;
+        uint8_t* data = capture_gradient(options[i], &worker_frames);
+        TEST_ASSERT_EQUAL(frames, worker_frames);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, data, size);
+        free(data);
+    }
+    free(expected);
+}
+
+TEST_CASE("double-buffered LUTs match the 64K LUT output", "[epdiy,e2e]") {
+    int frames;
+    uint8_t* expected = capture_gradient(EPD_LUT_64K, &frames);
+    size_t size = (size_t)frames * ED097TC2.height * ED097TC2.width / 4;
+
+    // the next frame's LUT is built by the first worker done with its lines
+    const enum EpdInitOptions options[] = {
+        EPD_LUT_1K | EPD_RENDER_WORKERS(1),
+        EPD_LUT_1K | EPD_RENDER_WORKERS(2),
+        EPD_LUT_1K | EPD_RENDER_WORKERS(4) | EPD_RENDER_NO_AFFINITY,
+        EPD_LUT_1K | EPD_RENDER_WORKERS(8) | EPD_FEED_QUEUE_8,
+    };
+    for (int i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        int lut_frames;
+        uint8_t* data = capture_gradient(options[i], &lut_frames);
+        TEST_ASSERT_EQUAL(frames, lut_frames);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, data, size);
+        free(data);
+    }
+    free(expected);
+}
+
+TEST_CASE("repeated updates use the cached LUTs", "[epdiy,e2e]") {
+    int frames;
+    uint8_t* expected = capture_gradient(EPD_LUT_64K, &frames);
+    size_t size = (size_t)frames * ED097TC2.height * ED097TC2.width / 4;
+
+    // small LUTs are also taken from the cache by the workers building the next one
+    const enum EpdInitOptions options[] = {
+        EPD_LUT_64K | EPD_LUT_CACHE,
+        EPD_LUT_1K | EPD_LUT_CACHE | EPD_RENDER_WORKERS(4),
+    };
+    for (int i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        epd_init(&epd_board_host, &ED097TC2, options[i]);
+        epd_host_set_capture(true);
+
+        int fb_size = epd_width() / 2 * epd_height();
+        uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+        TEST_ASSERT_NOT_NULL(framebuffer);
+        for (int b = 0; b < fb_size; b++) {
+            framebuffer[b] = (b / (epd_width() / 2) % 16) * 0x11;
+        }
+
+        const EpdRenderStats* stats = epd_get_render_stats();
+        for (int update = 0; update < 2; update++) {
+            enum EpdDrawError err = epd_draw_base(
+                epd_full_screen(),
+                framebuffer,
+                epd_full_screen(),
+                MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+                25,
+                NULL,
+                NULL,
+                epd_get_display()->default_waveform
+            );
+            TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+            TEST_ASSERT_EQUAL(frames, epd_host_capture()->frames);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, epd_host_capture()->data, size);
+            TEST_ASSERT_EQUAL(frames, stats->lut_cache_hits + stats->lut_cache_misses);
+        }
+        if (options[i] & EPD_LUT_64K) {
+            // the mode has more frames than the cache has entries, the first ones are kept
+            TEST_ASSERT(stats->lut_cache_hits > 0);
+            TEST_ASSERT(stats->lut_cache_hits < frames);
+        } else {
+            TEST_ASSERT_EQUAL(frames, stats->lut_cache_hits);
+        }
+
+        heap_caps_free(framebuffer);
+        epd_host_set_capture(false);
+        epd_deinit();
+    }
+    free(expected);
+}
+
+TEST_CASE("render statistics describe the last update", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    memset(framebuffer, 0x00, fb_size);
+    bool* drawn_lines = calloc(epd_height(), sizeof(bool));
+    TEST_ASSERT_NOT_NULL(drawn_lines);
+    for (int l = epd_height() / 4; l < epd_height() / 2; l++) {
+        drawn_lines[l] = true;
+    }
+
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        drawn_lines,
+        NULL,
+        epd_get_display()->default_waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    const EpdRenderStats* stats = epd_get_render_stats();
+    const EpdHostCapture* capture = epd_host_capture();
+    TEST_ASSERT_EQUAL(capture->frames, stats->frames);
+    TEST_ASSERT_EQUAL(2, stats->workers);
+    TEST_ASSERT_EQUAL(31, stats->queue_capacity);
+    int lines_output = 0;
+    for (int f = 0; f < capture->frames; f++) {
+        lines_output += capture->frame_lines[f] - capture->frame_first_lines[f];
+    }
+    TEST_ASSERT_EQUAL(lines_output, stats->lines_output);
+    int drawn = epd_height() / 2 - epd_height() / 4;
+    TEST_ASSERT_EQUAL(stats->frames * drawn, stats->lines_driven);
+    TEST_ASSERT_EQUAL(lines_output - stats->lines_driven, stats->lines_skipped);
+    TEST_ASSERT(stats->queue_min >= 0 && stats->queue_min <= stats->queue_avg);
+    TEST_ASSERT(stats->queue_avg <= stats->queue_capacity);
+
+    for (int f = 0; f < capture->frames && capture->frame_numbers[f] < EPD_STATS_MAX_FRAMES; f++) {
+        TEST_ASSERT(stats->frame[capture->frame_numbers[f]].output_cycles > 0);
+    }
+
+    free(drawn_lines);
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+/**
+ * Draw black into the `height` lines from `y` of a white screen with `waveform`.
+ * Returns a copy of the modeled duration of each captured frame.
+ */
+static int* capture_band_durations(const EpdWaveform* waveform, int y, int height, int* frames) {
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    bool* drawn_lines = calloc(epd_height(), sizeof(bool));
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    TEST_ASSERT_NOT_NULL(drawn_lines);
+    memset(framebuffer, 0xFF, fb_size);
+    memset(framebuffer + y * epd_width() / 2, 0x00, height * epd_width() / 2);
+    for (int l = y; l < y + height; l++) {
+        drawn_lines[l] = true;
+    }
+
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        drawn_lines,
+        NULL,
+        waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    const EpdHostCapture* capture = epd_host_capture();
+    int* durations = malloc(capture->frames * sizeof(int));
+    TEST_ASSERT_NOT_NULL(durations);
+    memcpy(durations, capture->frame_durations, capture->frames * sizeof(int));
+    *frames = capture->frames;
+
+    free(drawn_lines);
+    heap_caps_free(framebuffer);
+    return durations;
+}
+
+TEST_CASE("frame time scales with the height of the drawn band", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+
+    // the LCD output does not follow the phase times, all lines take the default line time
+    const EpdWaveform* display_waveform = epd_get_display()->default_waveform;
+    EpdWaveformPhases phases = { 0 };
+    for (int i = 0; i < display_waveform->num_modes; i++) {
+        const EpdWaveformMode* mode = display_waveform->mode_data[i];
+        if (mode->type == MODE_GC16) {
+            phases = *mode->range_data[waveform_temp_range_index(display_waveform, 25)];
+        }
+    }
+    TEST_ASSERT(phases.phases > 0);
+    phases.phase_times = NULL;
+    const EpdWaveformPhases* range_data[] = { &phases };
+    const EpdWaveformMode mode = { .type = MODE_GC16, .temp_ranges = 1, .range_data = range_data };
+    const EpdWaveformMode* mode_data[] = { &mode };
+    const EpdWaveformTempInterval interval = { .min = 0, .max = 50 };
+    const EpdWaveform waveform = {
+        .num_modes = 1,
+        .num_temp_ranges = 1,
+        .mode_data = mode_data,
+        .temp_intervals = &interval,
+    };
+
+    const int band_height = 40;
+    const int bottom_y = epd_height() - band_height;
+    int top_frames, bottom_frames;
+    int* top = capture_band_durations(&waveform, 0, band_height, &top_frames);
+    int* bottom = capture_band_durations(&waveform, bottom_y, band_height, &bottom_frames);
+    TEST_ASSERT_EQUAL(top_frames, bottom_frames);
+    TEST_ASSERT(bottom_frames > 1);
+
+    const EpdHostCapture* capture = epd_host_capture();
+    // the first frame scans from the top, so the source driver holds a no-op line
+    TEST_ASSERT_EQUAL(0, capture->frame_first_lines[0]);
+    TEST_ASSERT_EQUAL(capture->frame_lines[0] * capture->frame_times[0], bottom[0]);
+    for (int f = 1; f < capture->frames; f++) {
+        int first_line = capture->frame_first_lines[f];
+        TEST_ASSERT_EQUAL(bottom_y / 8 * 8, first_line);
+        TEST_ASSERT(capture->frame_lines[f] - first_line <= band_height + 8);
+        for (int l = 0; l < first_line; l++) {
+            TEST_ASSERT(line_is_noop(capture, f, l));
+        }
+        // the lines above the band only take a gate clock pulse each
+        TEST_ASSERT_EQUAL(top[f] + first_line * SKIP_LINE_TIME, bottom[f]);
+        TEST_ASSERT(bottom[f] < capture->frame_lines[f] * capture->frame_times[f] / 2);
+    }
+
+    free(top);
+    free(bottom);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+TEST_CASE("only the drawn columns are driven", "[epdiy,e2e]") {
+    int frames;
+    uint8_t* expected = capture_gradient(EPD_LUT_64K, &frames);
+
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* drawn_columns = calloc(epd_width() / 2, 1);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    TEST_ASSERT_NOT_NULL(drawn_columns);
+    for (int i = 0; i < fb_size; i++) {
+        framebuffer[i] = (i / (epd_width() / 2) % 16) * 0x11;
+    }
+    // a narrow widget, not aligned to the lookup span
+    const int first_column = 101;
+    const int end_column = 151;
+    for (int x = first_column; x < end_column; x++) {
+        drawn_columns[x / 2] |= x % 2 ? 0xF0 : 0x0F;
+    }
+
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        drawn_columns,
+        epd_get_display()->default_waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    const EpdHostCapture* capture = epd_host_capture();
+    TEST_ASSERT_EQUAL(frames, capture->frames);
+    for (int f = 0; f < capture->frames; f++) {
+        for (int l = 0; l < capture->lines; l++) {
+            const uint8_t* line = captured_line(capture, f, l);
+            const uint8_t* full
+                = expected + ((size_t)f * capture->lines + l) * capture->line_bytes;
+            for (int x = 0; x < epd_width(); x++) {
+                int shift = 2 * (x % 4);
+                int action = (line[x / 4] >> shift) & 0x3;
+                bool drawn = x >= first_column && x < end_column;
+                TEST_ASSERT_EQUAL(drawn ? (full[x / 4] >> shift) & 0x3 : 0, action);
+            }
+        }
+    }
+
+    free(drawn_columns);
+    free(expected);
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+TEST_CASE("frames driving none of the transitions are skipped", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+    const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* to = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* from = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* dirty_columns = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_DEFAULT);
+    bool* dirty_lines = malloc(epd_height() * sizeof(bool));
+    EpdTransitions* line_transitions = malloc(epd_height() * sizeof(EpdTransitions));
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(dirty_columns);
+    TEST_ASSERT_NOT_NULL(dirty_lines);
+    TEST_ASSERT_NOT_NULL(line_transitions);
+
+    // a band of black lines turns white
+    memset(to, 0xFF, fb_size);
+    memset(from, 0xFF, fb_size);
+    memset(from + 100 * epd_width() / 2, 0x00, 40 * epd_width() / 2);
+
+    EpdTransitions transitions;
+    EpdRect area = epd_difference_image_transitions(
+        to,
+        from,
+        epd_full_screen(),
+        NULL,
+        dirty_lines,
+        dirty_columns,
+        &transitions,
+        line_transitions
+    );
+    TEST_ASSERT_EQUAL(100, area.y);
+    TEST_ASSERT_EQUAL(40, area.height);
+    for (int i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL_UINT16(i == 15 ? 0x0001 : 0x0000, transitions.to_from[i]);
+    }
+
+    // without the transitions, all frames of the mode are output
+    enum EpdDrawError err = epd_draw_difference(
+        epd_full_screen(),
+        to,
+        from,
+        area,
+        MODE_GC16,
+        25,
+        dirty_lines,
+        dirty_columns,
+        waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    const EpdHostCapture* capture = epd_host_capture();
+    int all_frames = capture->frames;
+    size_t frame_bytes = (size_t)capture->lines * capture->line_bytes;
+    uint8_t* expected = malloc(all_frames * frame_bytes);
+    TEST_ASSERT_NOT_NULL(expected);
+    memcpy(expected, capture->data, all_frames * frame_bytes);
+    for (int f = 0; f < all_frames; f++) {
+        TEST_ASSERT_EQUAL(f, capture->frame_numbers[f]);
+    }
+
+    EpdDrawOptions options = {
+        .from = from,
+        .transitions = &transitions,
+        .line_transitions = line_transitions,
+    };
+    err = epd_draw_base_with_options(
+        epd_full_screen(),
+        to,
+        area,
+        MODE_GC16,
+        25,
+        dirty_lines,
+        dirty_columns,
+        waveform,
+        &options
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    // black to white only drives in the second half of GC16
+    TEST_ASSERT(capture->frames > 0);
+    TEST_ASSERT(capture->frames < all_frames);
+    bool output[all_frames];
+    memset(output, 0, sizeof(output));
+    for (int f = 0; f < capture->frames; f++) {
+        int frame = capture->frame_numbers[f];
+        TEST_ASSERT(frame >= 0 && frame < all_frames);
+        output[frame] = true;
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(
+            expected + frame * frame_bytes, capture->data + f * frame_bytes, frame_bytes
+        );
+    }
+    // skipped frames do not drive any pixel
+    for (int f = 0; f < all_frames; f++) {
+        for (int i = 0; i < frame_bytes && !output[f]; i++) {
+            TEST_ASSERT_EQUAL_UINT8(0x00, expected[f * frame_bytes + i]);
+        }
+    }
+
+    free(expected);
+    free(line_transitions);
+    free(dirty_lines);
+    heap_caps_free(dirty_columns);
+    heap_caps_free(from);
+    heap_caps_free(to);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+TEST_CASE("on-the-fly differences match drawing the difference image", "[epdiy,e2e]") {
+    const enum EpdInitOptions lut_sizes[] = { EPD_LUT_64K, EPD_LUT_1K };
+    for (int i = 0; i < sizeof(lut_sizes) / sizeof(lut_sizes[0]); i++) {
+        epd_init(&epd_board_host, &ED097TC2, lut_sizes[i]);
+        epd_host_set_capture(true);
+        const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+        int fb_size = epd_width() / 2 * epd_height();
+        uint8_t* to = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* from = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* interlaced = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* dirty_columns = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_DEFAULT);
+        bool* dirty_lines = malloc(epd_height() * sizeof(bool));
+        TEST_ASSERT_NOT_NULL(to);
+        TEST_ASSERT_NOT_NULL(from);
+        TEST_ASSERT_NOT_NULL(interlaced);
+        TEST_ASSERT_NOT_NULL(dirty_columns);
+        TEST_ASSERT_NOT_NULL(dirty_lines);
+
+        // the upper lines are unchanged
+        fill_test_image(to, 3);
+        fill_test_image(from, 5);
+        memcpy(from, to, 100 * epd_width() / 2);
+        memset(interlaced, 0x00, 2 * fb_size);
+
+        EpdRect area = epd_difference_image(to, from, interlaced, dirty_lines, dirty_columns);
+        TEST_ASSERT_EQUAL(100, area.y);
+        area.x = 0;
+        area.width = epd_width();
+
+        enum EpdDrawError err = epd_draw_base(
+            epd_full_screen(),
+            interlaced,
+            area,
+            MODE_GC16 | MODE_PACKING_1PPB_DIFFERENCE,
+            25,
+            dirty_lines,
+            dirty_columns,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        int frames;
+        uint8_t* expected = copy_capture(&frames);
+        TEST_ASSERT(frames > 0);
+
+        err = epd_draw_difference(
+            epd_full_screen(),
+            to,
+            from,
+            area,
+            MODE_GC16,
+            25,
+            dirty_lines,
+            dirty_columns,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        const EpdHostCapture* capture = epd_host_capture();
+        TEST_ASSERT_EQUAL(frames, capture->frames);
+        size_t size = (size_t)frames * capture->lines * capture->line_bytes;
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, capture->data, size);
+
+        free(expected);
+        free(dirty_lines);
+        heap_caps_free(dirty_columns);
+        heap_caps_free(interlaced);
+        heap_caps_free(from);
+        heap_caps_free(to);
+        epd_host_set_capture(false);
+        epd_deinit();
+    }
+}
+
+/// Two high-level updates with the given options, returns a copy of the second one's drive data.
+static uint8_t* capture_highlevel_updates(int hl_options, int* frames) {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+    EpdiyHighlevelState hl = epd_hl_init_with_options(EPD_BUILTIN_WAVEFORM, hl_options);
+
+    uint8_t* fb = epd_hl_get_framebuffer(&hl);
+    fill_test_image(fb, 3);
+    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    // a partial change of the front buffer
+    EpdRect rect = { .x = 101, .y = 200, .width = 300, .height = 120 };
+    epd_fill_rect(rect, 0x80, fb);
+    err = epd_hl_update_area(&hl, MODE_GC16, 25, epd_full_screen());
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    uint8_t* data = copy_capture(frames);
+
+    epd_hl_deinit(&hl);
+    epd_host_set_capture(false);
+    epd_deinit();
+    return data;
+}
+
+TEST_CASE("high-level on-the-fly differences match difference images", "[epdiy,e2e]") {
+    int frames;
+    uint8_t* expected = capture_highlevel_updates(EPD_HL_DEFAULT, &frames);
+    TEST_ASSERT(frames > 0);
+
+    int on_the_fly_frames;
+    uint8_t* data = capture_highlevel_updates(EPD_HL_ON_THE_FLY_DIFFERENCE, &on_the_fly_frames);
+    TEST_ASSERT_EQUAL(frames, on_the_fly_frames);
+    size_t size = (size_t)frames * ED097TC2.height * ED097TC2.width / 4;
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, data, size);
+
+    free(data);
+    free(expected);
+}
+
+/// Fill a 2bpp framebuffer and a 4bpp framebuffer with the same gray levels.
+static void fill_test_image_2bpp(uint8_t* framebuffer_2bpp, uint8_t* framebuffer, int seed) {
+    memset(framebuffer_2bpp, 0x00, epd_width() / 4 * epd_height());
+    for (int y = 0; y < epd_height(); y++) {
+        for (int x = 0; x < epd_width(); x++) {
+            uint8_t v = (x * seed / 8 + y / 3) % 4;
+            framebuffer_2bpp[(y * epd_width() + x) / 4] |= v << (2 * (x % 4));
+            uint8_t* b = &framebuffer[(y * epd_width() + x) / 2];
+            *b = (x % 2) ? (*b & 0x0F) | (v * 5 << 4) : (*b & 0xF0) | (v * 5);
+        }
+    }
+}
+
+/// Whether a dirtyness nibble array marks the same columns as another.
+static bool same_dirty_columns(const uint8_t* a, const uint8_t* b) {
+    for (int i = 0; i < epd_width() / 2; i++) {
+        if (((a[i] & 0x0F) != 0) != ((b[i] & 0x0F) != 0)
+            || ((a[i] & 0xF0) != 0) != ((b[i] & 0xF0) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("2bpp framebuffers draw like the equivalent 4bpp framebuffers", "[epdiy,e2e]") {
+    // the cropping path of the I2S output shifts 2bpp lines by whole pixels
+    uint8_t crumbs[8], nibbles[16];
+    for (int shift = 1; shift < 4; shift++) {
+        for (int i = 0; i < 8; i++) {
+            crumbs[i] = 0x1B + 0x35 * i;
+            for (int p = 0; p < 2; p++) {
+                uint8_t low = (crumbs[i] >> (4 * p)) & 3;
+                uint8_t high = (crumbs[i] >> (4 * p + 2)) & 3;
+                nibbles[2 * i + p] = (high * 5 << 4) | (low * 5);
+            }
+        }
+        crumb_shift_buffer_right(crumbs, sizeof(crumbs), shift);
+        for (int s = 0; s < shift; s++) {
+            nibble_shift_buffer_right(nibbles, sizeof(nibbles));
+        }
+        for (int x = 0; x < 32; x++) {
+            uint8_t v = (crumbs[x / 4] >> (2 * (x % 4))) & 3;
+            TEST_ASSERT_EQUAL_UINT8(v * 5, (nibbles[x / 2] >> (4 * (x % 2))) & 0x0F);
+        }
+    }
+
+    const enum EpdInitOptions lut_sizes[] = { EPD_LUT_64K, EPD_LUT_1K };
+    for (int i = 0; i < sizeof(lut_sizes) / sizeof(lut_sizes[0]); i++) {
+        epd_init(&epd_board_host, &ED097TC2, lut_sizes[i]);
+        epd_host_set_capture(true);
+        const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+        int fb_size = epd_width() / 2 * epd_height();
+        int fb_size_2bpp = epd_width() / 4 * epd_height();
+        uint8_t* to = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* from = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* to_2bpp = heap_caps_aligned_alloc(16, fb_size_2bpp, MALLOC_CAP_DEFAULT);
+        uint8_t* from_2bpp = heap_caps_aligned_alloc(16, fb_size_2bpp, MALLOC_CAP_DEFAULT);
+        uint8_t* interlaced = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_DEFAULT);
+        uint8_t* dirty_columns = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_DEFAULT);
+        uint8_t* dirty_columns_2bpp
+            = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_DEFAULT);
+        bool* dirty_lines = malloc(epd_height() * sizeof(bool));
+        bool* dirty_lines_2bpp = malloc(epd_height() * sizeof(bool));
+        TEST_ASSERT_NOT_NULL(to);
+        TEST_ASSERT_NOT_NULL(from);
+        TEST_ASSERT_NOT_NULL(to_2bpp);
+        TEST_ASSERT_NOT_NULL(from_2bpp);
+        TEST_ASSERT_NOT_NULL(interlaced);
+        TEST_ASSERT_NOT_NULL(dirty_columns);
+        TEST_ASSERT_NOT_NULL(dirty_columns_2bpp);
+        TEST_ASSERT_NOT_NULL(dirty_lines);
+        TEST_ASSERT_NOT_NULL(dirty_lines_2bpp);
+        fill_test_image_2bpp(to_2bpp, to, 3);
+        fill_test_image_2bpp(from_2bpp, from, 5);
+
+        // with a known previous color, 2bpp bytes are looked up as they are fetched
+        enum EpdDrawError err = epd_draw_base(
+            epd_full_screen(),
+            to,
+            epd_full_screen(),
+            MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+            25,
+            NULL,
+            NULL,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        int frames;
+        uint8_t* expected = copy_capture(&frames);
+        TEST_ASSERT(frames > 0);
+
+        err = epd_draw_base(
+            epd_full_screen(),
+            to_2bpp,
+            epd_full_screen(),
+            MODE_GC16 | MODE_PACKING_4PPB | PREVIOUSLY_WHITE,
+            25,
+            NULL,
+            NULL,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        const EpdHostCapture* capture = epd_host_capture();
+        TEST_ASSERT_EQUAL(frames, capture->frames);
+        size_t size = (size_t)frames * capture->lines * capture->line_bytes;
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, capture->data, size);
+        free(expected);
+
+        // the upper and the left part are unchanged
+        for (int y = 0; y < epd_height(); y++) {
+            int copied = y < 100 ? epd_width() : 200;
+            memcpy(from + y * epd_width() / 2, to + y * epd_width() / 2, copied / 2);
+            memcpy(from_2bpp + y * epd_width() / 4, to_2bpp + y * epd_width() / 4, copied / 4);
+        }
+
+        EpdRect area = epd_difference_image_cropped(
+            to, from, epd_full_screen(), interlaced, dirty_lines, dirty_columns
+        );
+        EpdRect area_2bpp = epd_difference_4ppb_cropped(
+            to_2bpp, from_2bpp, epd_full_screen(), dirty_lines_2bpp, dirty_columns_2bpp
+        );
+        TEST_ASSERT_EQUAL(100, area.y);
+        TEST_ASSERT_EQUAL(area.x, area_2bpp.x);
+        TEST_ASSERT_EQUAL(area.y, area_2bpp.y);
+        TEST_ASSERT_EQUAL(area.width, area_2bpp.width);
+        TEST_ASSERT_EQUAL(area.height, area_2bpp.height);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(dirty_lines, dirty_lines_2bpp, epd_height());
+        TEST_ASSERT(same_dirty_columns(dirty_columns, dirty_columns_2bpp));
+        area.x = 0;
+        area.width = epd_width();
+
+        // both lines are interleaved by the render threads
+        err = epd_draw_difference(
+            epd_full_screen(),
+            to,
+            from,
+            area,
+            MODE_GC16,
+            25,
+            dirty_lines,
+            dirty_columns,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        expected = copy_capture(&frames);
+        TEST_ASSERT(frames > 0);
+
+        err = epd_draw_difference(
+            epd_full_screen(),
+            to_2bpp,
+            from_2bpp,
+            area,
+            MODE_GC16 | MODE_PACKING_4PPB,
+            25,
+            dirty_lines_2bpp,
+            dirty_columns_2bpp,
+            waveform
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+        TEST_ASSERT_EQUAL(frames, capture->frames);
+        size = (size_t)frames * capture->lines * capture->line_bytes;
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, capture->data, size);
+
+        free(expected);
+        free(dirty_lines_2bpp);
+        free(dirty_lines);
+        heap_caps_free(dirty_columns_2bpp);
+        heap_caps_free(dirty_columns);
+        heap_caps_free(interlaced);
+        heap_caps_free(from_2bpp);
+        heap_caps_free(to_2bpp);
+        heap_caps_free(from);
+        heap_caps_free(to);
+        epd_host_set_capture(false);
+        epd_deinit();
+    }
+}
+
+/// Number of frames of `phases` until the last frame driving pixels from `from` to `to`.
+static int transition_frames(const EpdWaveformPhases* phases, int to, int from) {
+    int frames = 0;
+    for (int f = 0; f < phases->phases; f++) {
+        const uint8_t* lut = phases->luts + 16 * 4 * f;
+        if ((lut[(to << 2) + (from >> 2)] >> (6 - 2 * (from & 3))) & 3) {
+            frames = f + 1;
+        }
+    }
+    return frames;
+}
+
+TEST_CASE("lines are not driven after their last transition frame", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+    const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+    int line_bytes = epd_width() / 2;
+    int fb_size = line_bytes * epd_height();
+    uint8_t* to = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* from = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* dirty_columns = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_DEFAULT);
+    bool* dirty_lines = malloc(epd_height() * sizeof(bool));
+    EpdTransitions* line_transitions = malloc(epd_height() * sizeof(EpdTransitions));
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_NOT_NULL(from);
+    TEST_ASSERT_NOT_NULL(dirty_columns);
+    TEST_ASSERT_NOT_NULL(dirty_lines);
+    TEST_ASSERT_NOT_NULL(line_transitions);
+
+    // white to black in the short lines, black to white in the long ones
+    const int short_start = 100, long_start = 200, band_height = 20;
+    memset(to, 0xFF, fb_size);
+    memset(from, 0xFF, fb_size);
+    memset(to + short_start * line_bytes, 0x00, band_height * line_bytes);
+    memset(from + long_start * line_bytes, 0x00, band_height * line_bytes);
+
+    const EpdWaveformPhases* phases = NULL;
+    for (int i = 0; i < waveform->num_modes; i++) {
+        if (waveform->mode_data[i]->type == MODE_GC16) {
+            phases = waveform->mode_data[i]->range_data[waveform_temp_range_index(waveform, 25)];
+        }
+    }
+    TEST_ASSERT_NOT_NULL(phases);
+    int short_frames = transition_frames(phases, 0, 15);
+    int long_frames = transition_frames(phases, 15, 0);
+    TEST_ASSERT(short_frames > 0 && short_frames < long_frames);
+
+    EpdTransitions transitions;
+    EpdRect area = epd_difference_image_transitions(
+        to,
+        from,
+        epd_full_screen(),
+        NULL,
+        dirty_lines,
+        dirty_columns,
+        &transitions,
+        line_transitions
+    );
+    area.x = 0;
+    area.width = epd_width();
+
+    // all lines are driven for all frames without the transitions per line
+    EpdDrawOptions options = { .from = from, .transitions = &transitions };
+    enum EpdDrawError err = epd_draw_base_with_options(
+        epd_full_screen(), to, area, MODE_GC16, 25, dirty_lines, dirty_columns, waveform, &options
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    int frames;
+    uint8_t* expected = copy_capture(&frames);
+    TEST_ASSERT_EQUAL(2 * band_height * frames, epd_get_render_stats()->lines_driven);
+
+    options.line_transitions = line_transitions;
+    err = epd_draw_base_with_options(
+        epd_full_screen(), to, area, MODE_GC16, 25, dirty_lines, dirty_columns, waveform, &options
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    const EpdHostCapture* capture = epd_host_capture();
+    TEST_ASSERT_EQUAL(frames, capture->frames);
+    TEST_ASSERT_EQUAL(long_frames, frames);
+    size_t frame_bytes = (size_t)capture->lines * capture->line_bytes;
+    bool long_driven_late = false;
+    for (int f = 0; f < capture->frames; f++) {
+        int frame = capture->frame_numbers[f];
+        TEST_ASSERT(capture->frame_lines[f] > long_start + band_height);
+        for (int l = 0; l < capture->frame_lines[f] && l < capture->lines; l++) {
+            bool short_line = l >= short_start && l < short_start + band_height;
+            bool long_line = l >= long_start && l < long_start + band_height;
+            if (short_line && frame >= short_frames) {
+                TEST_ASSERT(line_is_noop(capture, f, l));
+            }
+            if (short_line && frame < short_frames) {
+                TEST_ASSERT(!line_is_noop(capture, f, l));
+            }
+            if (long_line && frame >= short_frames) {
+                long_driven_late |= !line_is_noop(capture, f, l);
+            }
+        }
+        // skipping the finished lines does not change the output
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(
+            expected + f * frame_bytes, capture->data + f * frame_bytes, frame_bytes
+        );
+    }
+    TEST_ASSERT(long_driven_late);
+    int driven = band_height * (short_frames + long_frames);
+    TEST_ASSERT_EQUAL(driven, epd_get_render_stats()->lines_driven);
+
+    free(expected);
+    free(line_transitions);
+    free(dirty_lines);
+    heap_caps_free(dirty_columns);
+    heap_caps_free(from);
+    heap_caps_free(to);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+TEST_CASE("damaged tiles are diffed and synced like whole lines", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    EpdiyHighlevelState hl = epd_hl_init_with_options(EPD_BUILTIN_WAVEFORM, EPD_HL_TRACK_DAMAGE);
+
+    int line_bytes = epd_width() / 2;
+    int fb_size = line_bytes * epd_height();
+    int tiles = epd_damage_tiles_x() * epd_damage_tiles_y();
+    uint8_t* interlaced = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* expected_interlaced = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_DEFAULT);
+    uint8_t* dirty_columns = heap_caps_aligned_alloc(16, line_bytes, MALLOC_CAP_DEFAULT);
+    uint8_t* expected_columns = heap_caps_aligned_alloc(16, line_bytes, MALLOC_CAP_DEFAULT);
+    bool* dirty_lines = malloc(epd_height() * sizeof(bool));
+    bool* expected_lines = malloc(epd_height() * sizeof(bool));
+    uint8_t* expected_back = malloc(fb_size);
+    TEST_ASSERT_NOT_NULL(interlaced);
+    TEST_ASSERT_NOT_NULL(expected_interlaced);
+    TEST_ASSERT_NOT_NULL(dirty_columns);
+    TEST_ASSERT_NOT_NULL(expected_columns);
+    TEST_ASSERT_NOT_NULL(dirty_lines);
+    TEST_ASSERT_NOT_NULL(expected_lines);
+    TEST_ASSERT_NOT_NULL(expected_back);
+
+    // two distant changes, not aligned to the tiles
+    uint8_t* fb = epd_hl_get_framebuffer(&hl);
+    epd_fill_rect((EpdRect){ .x = 45, .y = 50, .width = 21, .height = 9 }, 0x00, fb);
+    epd_fill_rect((EpdRect){ .x = 1001, .y = 700, .width = 40, .height = 41 }, 0x70, fb);
+    int damaged = 0;
+    for (int i = 0; i < tiles; i++) {
+        damaged += hl.dirty_tiles[i] != 0;
+    }
+    TEST_ASSERT_EQUAL(2 + 2 * 3, damaged);
+
+    EpdRect expected_area = epd_difference_image_cropped(
+        hl.front_fb,
+        hl.back_fb,
+        epd_full_screen(),
+        expected_interlaced,
+        expected_lines,
+        expected_columns
+    );
+    EpdRect area = epd_difference_image_tiles(
+        hl.front_fb,
+        hl.back_fb,
+        epd_full_screen(),
+        hl.dirty_tiles,
+        interlaced,
+        dirty_lines,
+        dirty_columns,
+        NULL,
+        NULL
+    );
+    TEST_ASSERT_EQUAL(expected_area.x, area.x);
+    TEST_ASSERT_EQUAL(expected_area.y, area.y);
+    TEST_ASSERT_EQUAL(expected_area.width, area.width);
+    TEST_ASSERT_EQUAL(expected_area.height, area.height);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_lines, dirty_lines, epd_height() * sizeof(bool));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_columns, dirty_columns, line_bytes);
+    // the drawn part of the difference image
+    for (int y = 0; y < epd_height(); y++) {
+        for (int x = 0; x < epd_width() && dirty_lines[y]; x++) {
+            if (dirty_columns[x / 2] & (x % 2 ? 0xF0 : 0x0F)) {
+                TEST_ASSERT_EQUAL_UINT8(
+                    expected_interlaced[y * epd_width() + x], interlaced[y * epd_width() + x]
+                );
+            }
+        }
+    }
+
+    // the back buffer after copying the changed lines completely
+    memcpy(expected_back, hl.back_fb, fb_size);
+    for (int y = 0; y < epd_height(); y++) {
+        if (expected_lines[y]) {
+            memcpy(expected_back + y * line_bytes, hl.front_fb + y * line_bytes, line_bytes);
+        }
+    }
+    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_back, hl.back_fb, fb_size);
+    for (int i = 0; i < tiles; i++) {
+        TEST_ASSERT_EQUAL_UINT8(0, hl.dirty_tiles[i]);
+    }
+
+    free(expected_back);
+    free(expected_lines);
+    free(dirty_lines);
+    heap_caps_free(expected_columns);
+    heap_caps_free(dirty_columns);
+    heap_caps_free(expected_interlaced);
+    heap_caps_free(interlaced);
+    epd_hl_deinit(&hl);
+    epd_deinit();
+}
+
+static int count_occurrences(const char* str, const char* pattern) {
+    int count = 0;
+    for (const char* p = str; (p = strstr(p, pattern)) != NULL; p++) {
+        count++;
+    }
+    return count;
+}
+
+TEST_CASE("tracer records the update pipeline as Chrome trace JSON", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    memset(framebuffer, 0x00, fb_size);
+    enum EpdDrawMode mode = MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE;
+    const EpdWaveform* waveform = epd_get_display()->default_waveform;
+
+    // nothing is recorded by default
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(), framebuffer, epd_full_screen(), mode, 25, NULL, NULL, waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    TEST_ASSERT_EQUAL(0, epd_trace_event_count());
+
+    TEST_ASSERT(epd_trace_start(1 << 16));
+    err = epd_draw_base(
+        epd_full_screen(), framebuffer, epd_full_screen(), mode, 25, NULL, NULL, waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    epd_trace_stop();
+
+    // an update span, one span per frame and line, feed frames and chunks of both workers
+    const EpdHostCapture* capture = epd_host_capture();
+    int lines = capture->frames * epd_height();
+    TEST_ASSERT(epd_trace_event_count() > 1 + 2 * capture->frames + lines);
+
+    char* json = NULL;
+    size_t json_size = 0;
+    FILE* out = open_memstream(&json, &json_size);
+    TEST_ASSERT_NOT_NULL(out);
+    epd_trace_write_json(out);
+    fclose(out);
+
+    TEST_ASSERT_EQUAL(0, strncmp(json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 38));
+    TEST_ASSERT_EQUAL(lines, count_occurrences(json, "{\"name\":\"line output\","));
+    TEST_ASSERT_EQUAL(capture->frames, count_occurrences(json, "{\"name\":\"frame\","));
+    TEST_ASSERT_EQUAL(1, count_occurrences(json, "{\"name\":\"update\",\"cat\""));
+    free(json);
+
+    // only the latest events are kept
+    TEST_ASSERT(epd_trace_start(100));
+    err = epd_draw_base(
+        epd_full_screen(), framebuffer, epd_full_screen(), mode, 25, NULL, NULL, waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+    TEST_ASSERT_EQUAL(100, epd_trace_event_count());
+    epd_trace_free();
+    TEST_ASSERT_EQUAL(0, epd_trace_event_count());
+
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+TEST_CASE("panel model follows the driven pixel actions", "[epdiy,unit]") {
+    EpdPanelModel model;
+    TEST_ASSERT(epd_panel_model_init(&model, 8, 2));
+
+    // darken, lighten, no-op, no-op in both lines
+    uint8_t lines[4] = { 0x09, 0x09, 0x09, 0x09 };
+    // half way to the driven color with a frame of tau * ln(2)
+    int line_time = (int)(EPD_PANEL_MODEL_DEFAULT_TAU_US * 0.6931f * 10.0f / 2.0f);
+    epd_panel_model_apply_frame(&model, lines, 2, 2, line_time);
+
+    uint8_t image[16];
+    epd_panel_model_image(&model, image);
+    TEST_ASSERT(image[0] >= 127 && image[0] <= 128);
+    TEST_ASSERT_EQUAL(255, image[1]);
+    TEST_ASSERT_EQUAL(255, image[2]);
+    TEST_ASSERT(image[8] >= 127 && image[8] <= 128);
+    TEST_ASSERT_EQUAL(1, model.frames);
+    TEST_ASSERT(model.update_time_us > 0.0);
+
+    epd_panel_model_free(&model);
+}
+
+TEST_CASE("panel model predicts a black screen after drawing black", "[epdiy,e2e]") {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_64K);
+    epd_host_set_capture(true);
+
+    int fb_size = epd_width() / 2 * epd_height();
+    uint8_t* framebuffer = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(framebuffer);
+    memset(framebuffer, 0x00, fb_size);
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        framebuffer,
+        epd_full_screen(),
+        MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        NULL,
+        epd_get_display()->default_waveform
+    );
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+    EpdPanelModel model;
+    TEST_ASSERT(epd_panel_model_init(&model, epd_width(), epd_height()));
+    double time_us = epd_panel_model_apply_capture(&model, epd_host_capture(), NULL);
+    TEST_ASSERT(time_us > 0.0);
+
+    uint8_t* image = malloc(epd_width() * epd_height());
+    TEST_ASSERT_NOT_NULL(image);
+    epd_panel_model_image(&model, image);
+    for (int i = 0; i < epd_width() * epd_height(); i++) {
+        TEST_ASSERT(image[i] < 8);
+    }
+
+    free(image);
+    epd_panel_model_free(&model);
+    heap_caps_free(framebuffer);
+    epd_host_set_capture(false);
+    epd_deinit();
+}
+
+#endif
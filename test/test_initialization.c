@@ -12,6 +12,8 @@
 #define TEST_BOARD epd_board_v6
 #elif defined(CONFIG_IDF_TARGET_ESP32S3)
 #define TEST_BOARD epd_board_v7
+#elif defined(CONFIG_IDF_TARGET_LINUX)
+#define TEST_BOARD epd_board_host
 #endif
 
 TEST_CASE("initialization and deinitialization works", "[epdiy,e2e]") {
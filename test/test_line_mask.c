@@ -4,6 +4,7 @@
 #include <unity.h>
 
 void epd_populate_line_mask(uint8_t* line_mask, const uint8_t* dirty_columns, int mask_len);
+void epd_find_column_span(const uint8_t* dirty_columns, int width, int* span_x, int* span_width);
 
 const uint8_t col_dirtyness_example[8] = { 0x00, 0x0F, 0x00, 0x11, 0xFF, 0xFF, 0x00, 0x80 };
 
@@ -23,3 +24,28 @@ TEST_CASE("neutral mask with null dirtyness", "[epdiy,unit]") {
 
     TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_mask, mask, 8);
 }
+
+TEST_CASE("column span covers the dirty columns", "[epdiy,unit]") {
+    uint8_t dirtyness[200] = { 0 };
+    int x, width;
+
+    epd_find_column_span(NULL, 400, &x, &width);
+    TEST_ASSERT_EQUAL(0, x);
+    TEST_ASSERT_EQUAL(400, width);
+
+    epd_find_column_span(dirtyness, 400, &x, &width);
+    TEST_ASSERT_EQUAL(0, width);
+
+    // columns 130 to 201, aligned to 64 pixels
+    dirtyness[65] = 0x01;
+    dirtyness[100] = 0x10;
+    epd_find_column_span(dirtyness, 400, &x, &width);
+    TEST_ASSERT_EQUAL(128, x);
+    TEST_ASSERT_EQUAL(128, width);
+
+    // limited to the line width
+    dirtyness[199] = 0x10;
+    epd_find_column_span(dirtyness, 400, &x, &width);
+    TEST_ASSERT_EQUAL(128, x);
+    TEST_ASSERT_EQUAL(272, width);
+}
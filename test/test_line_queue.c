@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "output_common/line_queue.h"
+
+TEST_CASE("line queue peek borrows elements in order", "[epdiy,unit]") {
+    LineQueue_t lq = lq_init(3, 16);
+    TEST_ASSERT_NULL(lq_peek(&lq));
+    TEST_ASSERT_EQUAL(2, lq_free_slots(&lq));
+
+    // fill and drain the queue twice, to wrap around
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 2; i++) {
+            uint8_t* buf = lq_current(&lq);
+            TEST_ASSERT_NOT_NULL(buf);
+            memset(buf, round * 2 + i, 16);
+            lq_commit(&lq);
+        }
+        // one slot is kept free to tell a full queue from an empty one
+        TEST_ASSERT_NULL(lq_current(&lq));
+        TEST_ASSERT_EQUAL(0, lq_free_slots(&lq));
+
+        for (int i = 0; i < 2; i++) {
+            const uint8_t* line = lq_peek(&lq);
+            TEST_ASSERT_NOT_NULL(line);
+            // peeking again returns the same element
+            TEST_ASSERT_EQUAL_PTR(line, lq_peek(&lq));
+            TEST_ASSERT_EQUAL(round * 2 + i, line[0]);
+            TEST_ASSERT_EQUAL(round * 2 + i, line[15]);
+            // the borrowed element is not handed to the producer
+            if (i == 0) {
+                TEST_ASSERT_NULL(lq_current(&lq));
+            }
+            lq_release(&lq);
+            TEST_ASSERT_EQUAL(i + 1, lq_free_slots(&lq));
+        }
+        TEST_ASSERT_NULL(lq_peek(&lq));
+    }
+
+    lq_free(&lq);
+}
+
+TEST_CASE("line queue read copies and removes elements", "[epdiy,unit]") {
+    LineQueue_t lq = lq_init(2, 16);
+    uint8_t dst[16] = { 0 };
+    TEST_ASSERT_EQUAL(-1, lq_read(&lq, dst));
+
+    memset(lq_current(&lq), 0x42, 16);
+    lq_commit(&lq);
+    TEST_ASSERT_EQUAL(0, lq_read(&lq, dst));
+    TEST_ASSERT_EQUAL(0x42, dst[7]);
+    TEST_ASSERT_NULL(lq_peek(&lq));
+
+    lq_free(&lq);
+}
@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <esp_heap_caps.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -23,6 +24,14 @@ static const uint8_t result_pattern_2ppB_white[8]
     = { 0x00, 0x01, 0x50, 0x55, 0x55, 0x55, 0x00, 0x55 };
 static const uint8_t result_pattern_2ppB_black[8]
     = { 0xAA, 0xA8, 0x0A, 0x82, 0xAA, 0xAA, 0xAA, 0x20 };
+static const uint8_t result_pattern_4ppB_white[16] = { 0x00, 0x00, 0x05, 0x00, 0x00, 0x55,
+                                                       0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+                                                       0x00, 0x00, 0x55, 0x55 };
+static const uint8_t result_pattern_4ppB_black[16] = { 0xAA, 0xAA, 0xA0, 0xAA, 0xAA, 0x00,
+                                                       0x02, 0x20, 0xAA, 0xAA, 0xAA, 0xAA,
+                                                       0xAA, 0xAA, 0x00, 0x08 };
+static const uint8_t result_pattern_4ppB_difference[8]
+    = { 0x00, 0x0A, 0x55, 0x21, 0x00, 0x00, 0x00, 0x08 };
 static const uint8_t result_pattern_8ppB_on_white[32]
     = { 0x00, 0x00, 0x00, 0x00, 0x55, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55,
         0x55, 0x54, 0x55, 0x55, 0x54, 0x44, 0x11, 0x44, 0x11, 0x11, 0x44,
@@ -193,6 +202,19 @@ TEST_CASE("1ppB lookup LCD, 64k LUT", "[epdiy,unit,lut]") {
     diff_test_buffers_free(&bufs);
 }
 
+TEST_CASE("1ppB lookup, 1k LUT", "[epdiy,unit,lut]") {
+    LutTestBuffers bufs;
+    lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN, result_pattern_1ppB, 4);
+
+    enum EpdDrawMode mode = MODE_GL16 | MODE_PACKING_1PPB_DIFFERENCE | MODE_FORCE_NO_PIE;
+    LutFunctionPair func_pair = find_lut_functions(mode, 1 << 10);
+    TEST_ASSERT_NOT_NULL(func_pair.build_func);
+    func_pair.build_func(bufs.lut, &test_waveform, 0);
+    test_with_alignments(&bufs, func_pair.lookup_func);
+
+    diff_test_buffers_free(&bufs);
+}
+
 #if !DISABLED_FOR_TARGETS(ESP32)
 TEST_CASE("1ppB lookup LCD, 1k LUT, PIE", "[epdiy,unit,lut]") {
     LutTestBuffers bufs;
@@ -254,6 +276,58 @@ TEST_CASE("2ppB lookup LCD, 1k LUT, previously black", "[epdiy,unit,lut]") {
     diff_test_buffers_free(&bufs);
 }
 
+TEST_CASE("4ppB lookup, 1k LUT, previously white", "[epdiy,unit,lut]") {
+    LutTestBuffers bufs;
+    lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN, result_pattern_4ppB_white, 1);
+
+    enum EpdDrawMode mode = MODE_GL16 | MODE_PACKING_4PPB | PREVIOUSLY_WHITE;
+    LutFunctionPair func_pair = find_lut_functions(mode, 1 << 10);
+    TEST_ASSERT_NOT_NULL(func_pair.build_func);
+    func_pair.build_func(bufs.lut, &test_waveform, 0);
+    test_with_alignments(&bufs, func_pair.lookup_func);
+
+    diff_test_buffers_free(&bufs);
+}
+
+TEST_CASE("4ppB lookup, 64k LUT, previously black", "[epdiy,unit,lut]") {
+    LutTestBuffers bufs;
+    lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN, result_pattern_4ppB_black, 1);
+
+    enum EpdDrawMode mode = MODE_GL16 | MODE_PACKING_4PPB | PREVIOUSLY_BLACK;
+    LutFunctionPair func_pair = find_lut_functions(mode, 1 << 16);
+    TEST_ASSERT_NOT_NULL(func_pair.build_func);
+    func_pair.build_func(bufs.lut, &test_waveform, 0);
+    test_with_alignments(&bufs, func_pair.lookup_func);
+
+    diff_test_buffers_free(&bufs);
+}
+
+TEST_CASE("4ppB difference lookup, 1k LUT", "[epdiy,unit,lut]") {
+    LutTestBuffers bufs;
+    lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN, result_pattern_4ppB_difference, 2);
+
+    enum EpdDrawMode mode = MODE_GL16 | MODE_PACKING_4PPB;
+    LutFunctionPair func_pair = find_lut_functions(mode, 1 << 10);
+    TEST_ASSERT_NOT_NULL(func_pair.build_func);
+    func_pair.build_func(bufs.lut, &test_waveform, 0);
+    test_with_alignments(&bufs, func_pair.lookup_func);
+
+    diff_test_buffers_free(&bufs);
+}
+
+TEST_CASE("4ppB difference lookup, 64k LUT", "[epdiy,unit,lut]") {
+    LutTestBuffers bufs;
+    lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN, result_pattern_4ppB_difference, 2);
+
+    enum EpdDrawMode mode = MODE_GL16 | MODE_PACKING_4PPB;
+    LutFunctionPair func_pair = find_lut_functions(mode, 1 << 16);
+    TEST_ASSERT_NOT_NULL(func_pair.build_func);
+    func_pair.build_func(bufs.lut, &test_waveform, 0);
+    test_with_alignments(&bufs, func_pair.lookup_func);
+
+    diff_test_buffers_free(&bufs);
+}
+
 TEST_CASE("8ppB lookup LCD, 1k LUT, previously white", "[epdiy,unit,lut]") {
     LutTestBuffers bufs;
     lut_test_buffers_init(&bufs, DEFAULT_EXAMPLE_LEN / 2, result_pattern_8ppB_on_white, 0.5);
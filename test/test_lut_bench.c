@@ -0,0 +1,190 @@
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <xtensa/core-macros.h>
+
+#include "epd_display.h"
+#include "epdiy.h"
+#include "output_common/lut.h"
+#include "output_common/render_method.h"
+
+/**
+ * Benchmarks of the LUT lookup and building functions.
+ *
+ * Results are printed as one JSON object per line, prefixed with "BENCH ",
+ * e.g. for collection with `grep '^BENCH ' | cut -c7-`.
+ */
+
+/// Number of lines looked up per batch.
+#define BENCH_LINES 200
+/// Number of LUT builds per batch.
+#define BENCH_BUILDS 20
+/// Batches are repeated for at least this time, for sufficient timer resolution.
+#define BENCH_MIN_TIME_US 10000
+
+typedef struct {
+    const char* name;
+    enum EpdDrawMode mode;
+    uint32_t lut_size;
+} BenchKernel;
+
+static const BenchKernel bench_kernels[] = {
+    { "1ppB_64k", MODE_GL16 | MODE_PACKING_1PPB_DIFFERENCE | MODE_FORCE_NO_PIE, 1 << 16 },
+    { "1ppB_1k", MODE_GL16 | MODE_PACKING_1PPB_DIFFERENCE | MODE_FORCE_NO_PIE, 1 << 10 },
+#ifdef RENDER_METHOD_LCD
+    { "1ppB_1k_S3_VE", MODE_GL16 | MODE_PACKING_1PPB_DIFFERENCE, 1 << 10 },
+#endif
+    { "2ppB_64k_white", MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE, 1 << 16 },
+    { "2ppB_64k_black", MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_BLACK, 1 << 16 },
+    { "2ppB_1k_white", MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE, 1 << 10 },
+    { "2ppB_1k_black", MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_BLACK, 1 << 10 },
+    { "4ppB_256b_white", MODE_GL16 | MODE_PACKING_4PPB | PREVIOUSLY_WHITE, 1 << 10 },
+    { "4ppB_256b_black", MODE_GL16 | MODE_PACKING_4PPB | PREVIOUSLY_BLACK, 1 << 10 },
+    { "4ppB_difference_64k", MODE_GL16 | MODE_PACKING_4PPB, 1 << 16 },
+    { "4ppB_difference_1k", MODE_GL16 | MODE_PACKING_4PPB, 1 << 10 },
+    { "8ppB_white", MODE_DU | MODE_PACKING_8PPB | PREVIOUSLY_WHITE, 1 << 10 },
+    { "8ppB_black", MODE_DU | MODE_PACKING_8PPB | PREVIOUSLY_BLACK, 1 << 10 },
+};
+
+static const EpdDisplay_t* bench_displays[] = {
+    &ED060SCT, &ED060XC3, &ED097OC4, &ED097TC2, &ED133UT2,
+    &ED047TC1, &ED047TC2, &ED078KC1, &ED052TC4,
+};
+
+static uint8_t bench_waveform_phases[16][4];
+
+static const EpdWaveformPhases bench_waveform = {
+    .phase_times = NULL,
+    .phases = 1,
+    .luts = (uint8_t*)bench_waveform_phases,
+};
+
+/// Darken for lower target values, lighten for higher ones.
+static void fill_bench_waveform() {
+    for (int to = 0; to < 16; to++) {
+        memset(bench_waveform_phases[to], 0, 4);
+        for (int from = 0; from < 16; from++) {
+            uint8_t val = to < from ? 0x01 : (to > from ? 0x02 : 0x00);
+            bench_waveform_phases[to][from >> 2] |= val << (3 - (from & 0x3)) * 2;
+        }
+    }
+}
+
+/// Pseudo-random input data, so lookups access the whole LUT.
+static void fill_bench_input(uint8_t* buf, int len) {
+    uint32_t x = 0x12345678;
+    for (int i = 0; i < len; i++) {
+        x = x * 1103515245 + 12345;
+        buf[i] = x >> 24;
+    }
+}
+
+static void bench_lookup(
+    const BenchKernel* kernel,
+    lut_func_t lookup,
+    const uint8_t* lut,
+    uint8_t* input,
+    uint8_t* output,
+    int width,
+    bool aligned
+) {
+    // Inputs are at most one byte per pixel.
+    // Keep the 32 bit alignment required by the kernels, but break the 16 byte alignment.
+    int offset = aligned ? 0 : 4;
+    const uint32_t* line = (const uint32_t*)(input + offset);
+    uint8_t* out = output + offset;
+
+    // warm up caches
+    lookup(line, out, lut, width);
+
+    int lines = 0;
+    uint64_t elapsed_cycles = 0;
+    int64_t start_us = esp_timer_get_time();
+    int64_t elapsed_us = 0;
+    while (elapsed_us < BENCH_MIN_TIME_US) {
+        uint32_t start_cycles = XTHAL_GET_CCOUNT();
+        for (int i = 0; i < BENCH_LINES; i++) {
+            lookup(line, out, lut, width);
+        }
+        elapsed_cycles += (uint32_t)(XTHAL_GET_CCOUNT() - start_cycles);
+        elapsed_us = esp_timer_get_time() - start_us;
+        lines += BENCH_LINES;
+    }
+
+    double mpix_per_s = (double)width * lines / elapsed_us;
+    printf(
+        "BENCH {\"kernel\":\"%s\",\"width\":%d,\"aligned\":%s,\"mpix_per_s\":%.2f,"
+        "\"cycles_per_line\":%lu}\n",
+        kernel->name,
+        width,
+        aligned ? "true" : "false",
+        mpix_per_s,
+        (unsigned long)(elapsed_cycles / lines)
+    );
+}
+
+TEST_CASE("LUT lookup and build throughput", "[epdiy,bench]") {
+    fill_bench_waveform();
+
+    int max_width = 0;
+    for (int d = 0; d < sizeof(bench_displays) / sizeof(bench_displays[0]); d++) {
+        if (bench_displays[d]->width > max_width) {
+            max_width = bench_displays[d]->width;
+        }
+    }
+
+    uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    uint8_t* lut = heap_caps_malloc(1 << 16, caps);
+    uint8_t* input = heap_caps_aligned_alloc(16, max_width + 16, caps);
+    uint8_t* output = heap_caps_aligned_alloc(16, max_width / 4 + 16, caps);
+    TEST_ASSERT_NOT_NULL(lut);
+    TEST_ASSERT_NOT_NULL(input);
+    TEST_ASSERT_NOT_NULL(output);
+    fill_bench_input(input, max_width + 16);
+
+    for (int k = 0; k < sizeof(bench_kernels) / sizeof(bench_kernels[0]); k++) {
+        const BenchKernel* kernel = &bench_kernels[k];
+        LutFunctionPair pair = find_lut_functions(kernel->mode, kernel->lut_size);
+        TEST_ASSERT_NOT_NULL(pair.build_func);
+        TEST_ASSERT_NOT_NULL(pair.lookup_func);
+
+        int builds = 0;
+        uint64_t elapsed_cycles = 0;
+        int64_t start_us = esp_timer_get_time();
+        while (esp_timer_get_time() - start_us < BENCH_MIN_TIME_US) {
+            uint32_t start_cycles = XTHAL_GET_CCOUNT();
+            for (int i = 0; i < BENCH_BUILDS; i++) {
+                pair.build_func(lut, &bench_waveform, 0);
+            }
+            elapsed_cycles += (uint32_t)(XTHAL_GET_CCOUNT() - start_cycles);
+            builds += BENCH_BUILDS;
+        }
+        printf(
+            "BENCH {\"builder\":\"%s\",\"lut_size\":%u,\"cycles_per_build\":%lu}\n",
+            kernel->name,
+            (unsigned)pair.lut_size,
+            (unsigned long)(elapsed_cycles / builds)
+        );
+
+        int last_width = 0;
+        for (int d = 0; d < sizeof(bench_displays) / sizeof(bench_displays[0]); d++) {
+            int width = bench_displays[d]->width;
+            // displays of the same width give the same results
+            if (width == last_width) {
+                continue;
+            }
+            last_width = width;
+
+            bench_lookup(kernel, pair.lookup_func, lut, input, output, width, true);
+            bench_lookup(kernel, pair.lookup_func, lut, input, output, width, false);
+        }
+    }
+
+    heap_caps_free(lut);
+    heap_caps_free(input);
+    heap_caps_free(output);
+}
@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "output_common/lut_cache.h"
+
+static LutCacheKey_t cache_key(int waveform_index, int frame) {
+    LutCacheKey_t key = {
+        .build_func = NULL,
+        .waveform = NULL,
+        .waveform_index = waveform_index,
+        .waveform_range = 0,
+        .frame = frame,
+    };
+    return key;
+}
+
+TEST_CASE("LUT cache keeps the first frames of a mode which does not fit", "[epdiy,unit]") {
+    LutCache_t cache;
+    TEST_ASSERT(lut_cache_init(&cache, 16, 4 * 16));
+    TEST_ASSERT_EQUAL(4, cache.num_entries);
+
+    uint8_t lut[16];
+    // an update with more frames than entries, twice
+    for (int round = 0; round < 2; round++) {
+        for (int frame = 0; frame < 10; frame++) {
+            LutCacheKey_t key = cache_key(0, frame);
+            if (lut_cache_fetch(&cache, &key, lut)) {
+                TEST_ASSERT(round == 1 && frame < 4);
+                for (int i = 0; i < 16; i++) {
+                    TEST_ASSERT_EQUAL_UINT8(frame, lut[i]);
+                }
+                continue;
+            }
+            TEST_ASSERT(round == 0 || frame >= 4);
+            memset(lut, frame, sizeof(lut));
+            lut_cache_store(&cache, &key, lut, sizeof(lut));
+        }
+    }
+
+    // another mode evicts the least recently used frames
+    LutCacheKey_t key = cache_key(0, 0);
+    TEST_ASSERT(lut_cache_fetch(&cache, &key, lut));
+    for (int frame = 0; frame < 2; frame++) {
+        key = cache_key(1, frame);
+        memset(lut, 0x80 + frame, sizeof(lut));
+        lut_cache_store(&cache, &key, lut, sizeof(lut));
+    }
+    const bool cached[4] = { true, false, false, true };
+    for (int frame = 0; frame < 4; frame++) {
+        key = cache_key(0, frame);
+        TEST_ASSERT(lut_cache_fetch(&cache, &key, lut) == cached[frame]);
+    }
+    key = cache_key(1, 1);
+    TEST_ASSERT(lut_cache_fetch(&cache, &key, lut));
+    TEST_ASSERT_EQUAL_UINT8(0x81, lut[0]);
+
+    lut_cache_free(&cache);
+}
@@ -0,0 +1,78 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "output_common/render_context.h"
+
+static RenderContext_t feed_context(int tasks, int lines, int chunk) {
+    RenderContext_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.num_feed_tasks = tasks;
+    ctx.lines_total = lines;
+    ctx.line_chunk = chunk;
+    atomic_init(&ctx.lines_prepared, 0);
+    for (int i = 0; i < MAX_RENDER_THREADS; i++) {
+        atomic_init(&ctx.feed_lines[i], 0);
+    }
+    return ctx;
+}
+
+TEST_CASE("feed tasks take every line once, in increasing order", "[epdiy,unit]") {
+    RenderContext_t ctx = feed_context(3, 100, 8);
+    bool taken[100] = { false };
+    int last[3] = { -1, -1, -1 };
+    bool done[3] = { false };
+
+    // interleave the tasks unevenly, so lines are stolen at the end
+    int remaining = 3;
+    for (int step = 0; remaining > 0; step++) {
+        int t = step % 7 < 5 ? 0 : (step % 7 < 6 ? 1 : 2);
+        if (done[t]) {
+            t = !done[0] ? 0 : (!done[1] ? 1 : 2);
+        }
+        int l = epd_next_feed_line(&ctx, t);
+        if (l < 0) {
+            done[t] = true;
+            remaining--;
+            continue;
+        }
+        TEST_ASSERT(l < 100);
+        TEST_ASSERT_FALSE(taken[l]);
+        TEST_ASSERT(l > last[t]);
+        taken[l] = true;
+        last[t] = l;
+    }
+    for (int l = 0; l < 100; l++) {
+        TEST_ASSERT(taken[l]);
+    }
+}
+
+TEST_CASE("idle feed tasks steal lines of other tasks", "[epdiy,unit]") {
+    RenderContext_t ctx = feed_context(2, 8, 8);
+
+    // task 0 claims all lines, task 1 steals the upper half
+    TEST_ASSERT_EQUAL(0, epd_next_feed_line(&ctx, 0));
+    TEST_ASSERT_EQUAL(5, epd_next_feed_line(&ctx, 1));
+    TEST_ASSERT_EQUAL(1, epd_next_feed_line(&ctx, 0));
+    TEST_ASSERT_EQUAL(6, epd_next_feed_line(&ctx, 1));
+    TEST_ASSERT_EQUAL(2, epd_next_feed_line(&ctx, 0));
+    TEST_ASSERT_EQUAL(3, epd_next_feed_line(&ctx, 0));
+    TEST_ASSERT_EQUAL(4, epd_next_feed_line(&ctx, 0));
+    // the last line is not split
+    TEST_ASSERT_EQUAL(-1, epd_next_feed_line(&ctx, 0));
+    TEST_ASSERT_EQUAL(7, epd_next_feed_line(&ctx, 1));
+    TEST_ASSERT_EQUAL(-1, epd_next_feed_line(&ctx, 1));
+
+    // lines below the last line of a task are never stolen by it
+    ctx = feed_context(2, 16, 8);
+    TEST_ASSERT_EQUAL(0, epd_next_feed_line(&ctx, 1));
+    for (int l = 8; l < 16; l++) {
+        TEST_ASSERT_EQUAL(l, epd_next_feed_line(&ctx, 0));
+    }
+    TEST_ASSERT_EQUAL(-1, epd_next_feed_line(&ctx, 0));
+    for (int l = 1; l < 8; l++) {
+        TEST_ASSERT_EQUAL(l, epd_next_feed_line(&ctx, 1));
+    }
+    TEST_ASSERT_EQUAL(-1, epd_next_feed_line(&ctx, 1));
+}